@@ -0,0 +1,115 @@
+#include "../include/allocator/IAllocator.h"
+#include "../include/allocator/PhysicalMemory.h"
+#include "../include/buddy/BuddyAllocator.h"
+#include "../include/tlsf/TlsfAllocator.h"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+// Replays one random allocate/free trace through every allocator and
+// reports mean and worst-case latency per operation.
+
+namespace {
+
+constexpr std::size_t kMemory = 1 << 26;
+constexpr int kOps = 200000;
+
+struct Op {
+    bool is_alloc;
+    std::size_t size;    // allocation size
+    std::size_t victim;  // index into the live set for frees
+};
+
+std::vector<Op> make_trace() {
+    std::mt19937 rng(99);
+    std::vector<Op> trace;
+    std::size_t live = 0;
+    for (int i = 0; i < kOps; ++i) {
+        // Grow to a large live set for the first half, then churn
+        bool alloc = live == 0 || rng() % 100 < (i < kOps / 2 ? 75u : 50u);
+        Op op{alloc, 16 + rng() % 1024, 0};
+        if (alloc) {
+            ++live;
+        } else {
+            op.victim = rng() % live;
+            --live;
+        }
+        trace.push_back(op);
+    }
+    return trace;
+}
+
+void run(IAllocator& allocator, const std::vector<Op>& trace) {
+    using clock = std::chrono::steady_clock;
+    std::vector<BlockHandle> live;
+    double total_ns[2] = {0, 0};
+    double worst_ns[2] = {0, 0};
+    std::size_t count[2] = {0, 0};
+    std::size_t failures = 0;
+
+    for (const Op& op : trace) {
+        if (!op.is_alloc && live.empty()) {
+            continue;
+        }
+        auto start = clock::now();
+        if (op.is_alloc) {
+            BlockHandle id = allocator.allocate(op.size);
+            auto ns = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+            total_ns[0] += ns;
+            worst_ns[0] = std::max(worst_ns[0], ns);
+            ++count[0];
+            if (id == -1) {
+                ++failures;
+            } else {
+                live.push_back(id);
+            }
+        } else {
+            std::size_t victim = op.victim % live.size();
+            allocator.free_block(live[victim]);
+            auto ns = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+            total_ns[1] += ns;
+            worst_ns[1] = std::max(worst_ns[1], ns);
+            ++count[1];
+            live[victim] = live.back();
+            live.pop_back();
+        }
+    }
+
+    std::cout << "  " << std::left << std::setw(14) << allocator.allocator_name() << std::right
+              << std::fixed << std::setprecision(0)
+              << std::setw(10) << total_ns[0] / count[0]
+              << std::setw(12) << worst_ns[0]
+              << std::setw(10) << total_ns[1] / count[1]
+              << std::setw(12) << worst_ns[1]
+              << std::setw(10) << failures << "\n";
+}
+
+} // namespace
+
+int main() {
+    std::vector<Op> trace = make_trace();
+
+    std::vector<std::unique_ptr<IAllocator>> allocators;
+    allocators.emplace_back(new PhysicalMemory(kMemory, AllocationStrategy::FIRST_FIT));
+    allocators.emplace_back(new PhysicalMemory(kMemory, AllocationStrategy::BEST_FIT));
+    allocators.emplace_back(new PhysicalMemory(kMemory, AllocationStrategy::WORST_FIT));
+    allocators.emplace_back(new PhysicalMemory(kMemory, AllocationStrategy::NEXT_FIT));
+    allocators.emplace_back(new BuddyAllocator(kMemory));
+    allocators.emplace_back(new BuddyAllocator(kMemory, CoalescingMode::LAZY));
+    allocators.emplace_back(new TlsfAllocator(kMemory));
+
+    std::cout << "Allocator latency benchmark (" << kOps << " ops, "
+              << kMemory << " bytes)\n";
+    std::cout << "  " << std::left << std::setw(14) << "allocator" << std::right
+              << std::setw(10) << "alloc ns" << std::setw(12) << "alloc max"
+              << std::setw(10) << "free ns" << std::setw(12) << "free max"
+              << std::setw(10) << "failed" << "\n";
+
+    for (auto& allocator : allocators) {
+        run(*allocator, trace);
+    }
+    return 0;
+}
@@ -0,0 +1,113 @@
+#include "../include/allocator/PhysicalMemory.h"
+#include "../include/buddy/BuddyAllocator.h"
+#include "../include/tlsf/TlsfAllocator.h"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+// Single versus batched calls on the same trace. Each round allocates a
+// group of same-sized objects (as a container growing or a message being
+// parsed would) and frees the group of the round before last, on a heap
+// that a pinned background keeps fragmented. TLSF has no batch override
+// and shows the cost of the default loop.
+
+namespace {
+
+constexpr std::size_t kMemory = 16 << 20;
+constexpr std::size_t kBatch = 16;
+constexpr int kRounds = 20000;
+constexpr std::size_t kSizes[] = {24, 48, 64, 96, 128, 256};
+
+using Factory = std::unique_ptr<IAllocator> (*)();
+
+std::unique_ptr<IAllocator> first_fit() {
+    return std::unique_ptr<IAllocator>(new PhysicalMemory(kMemory, AllocationStrategy::FIRST_FIT));
+}
+
+std::unique_ptr<IAllocator> best_fit() {
+    return std::unique_ptr<IAllocator>(new PhysicalMemory(kMemory, AllocationStrategy::BEST_FIT));
+}
+
+std::unique_ptr<IAllocator> buddy() {
+    return std::unique_ptr<IAllocator>(new BuddyAllocator(kMemory));
+}
+
+std::unique_ptr<IAllocator> tlsf() {
+    return std::unique_ptr<IAllocator>(new TlsfAllocator(kMemory));
+}
+
+// Returns allocate + free operations per second
+double run(IAllocator& allocator, bool batched) {
+    std::mt19937 rng(11);
+
+    // Pinned background with holes between the survivors
+    std::vector<BlockHandle> background;
+    for (int i = 0; i < 4000; ++i) {
+        background.push_back(allocator.allocate(kSizes[rng() % 6]));
+    }
+    for (std::size_t i = 0; i < background.size(); i += 2) {
+        allocator.free_block(background[i]);
+    }
+
+    std::vector<std::size_t> sizes(kBatch);
+    std::vector<BlockHandle> groups[2] = {std::vector<BlockHandle>(kBatch, kInvalidHandle),
+                                          std::vector<BlockHandle>(kBatch, kInvalidHandle)};
+    std::size_t ops = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < kRounds; ++round) {
+        std::vector<BlockHandle>& group = groups[round % 2];
+        if (batched) {
+            allocator.free_batch(group.data(), group.size());
+        } else {
+            for (BlockHandle id : group) {
+                allocator.free_block(id);
+            }
+        }
+
+        std::size_t size = kSizes[rng() % 6];
+        sizes.assign(kBatch, size);
+        if (batched) {
+            allocator.allocate_batch(sizes.data(), sizes.size(), group.data());
+        } else {
+            for (std::size_t i = 0; i < kBatch; ++i) {
+                group[i] = allocator.allocate(sizes[i]);
+            }
+        }
+        ops += 2 * kBatch;
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    return static_cast<double>(ops) / std::chrono::duration<double>(end - start).count();
+}
+
+} // namespace
+
+int main() {
+    std::cout << "Batch allocation benchmark (" << kRounds << " rounds of " << kBatch
+              << " same-size allocations and frees)\n";
+    std::cout << "  " << std::left << std::setw(12) << "allocator" << std::right
+              << std::setw(14) << "single Mops/s" << std::setw(14) << "batch Mops/s"
+              << std::setw(10) << "speedup" << "\n";
+
+    const std::pair<const char*, Factory> allocators[] = {
+        {"First Fit", first_fit},
+        {"Best Fit", best_fit},
+        {"Buddy", buddy},
+        {"TLSF", tlsf},
+    };
+    for (const auto& entry : allocators) {
+        std::unique_ptr<IAllocator> single = entry.second();
+        std::unique_ptr<IAllocator> batch = entry.second();
+        double single_rate = run(*single, false);
+        double batch_rate = run(*batch, true);
+        std::cout << "  " << std::left << std::setw(12) << entry.first << std::right
+                  << std::fixed << std::setprecision(2)
+                  << std::setw(14) << single_rate / 1e6 << std::setw(14) << batch_rate / 1e6
+                  << std::setw(9) << batch_rate / single_rate << "x\n";
+    }
+    return 0;
+}
@@ -0,0 +1,122 @@
+#include "../include/allocator/PhysicalMemory.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <random>
+#include <vector>
+
+// Scan throughput of the PhysicalMemory block store on a 100k-block heap.
+// "before" replays the same layout through a std::list<MemoryBlock> whose
+// nodes were allocated in random order, as they end up after a long
+// allocate/free churn; "after" walks the slab of index-linked records.
+
+namespace {
+
+constexpr std::size_t kBlocks = 120000;  // settles at ~100k blocks after the churn
+constexpr std::size_t kBlockSize = 64;
+constexpr int kPasses = 50;
+
+struct ScanResult {
+    std::size_t free_bytes;
+    std::size_t free_blocks;
+};
+
+template <typename Walk>
+double time_scans(Walk walk, ScanResult& result) {
+    auto start = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < kPasses; ++pass) {
+        result = walk();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+void report(const char* label, double seconds, std::size_t blocks) {
+    double blocks_per_sec = static_cast<double>(blocks) * kPasses / seconds;
+    std::cout << "  " << std::left << std::setw(28) << label
+              << std::right << std::fixed << std::setprecision(1)
+              << std::setw(10) << blocks_per_sec / 1e6 << " M blocks/s  ("
+              << std::setprecision(3) << seconds * 1e3 / kPasses << " ms/scan)\n";
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 rng(7);
+
+    // Build a heap of alternating used blocks and holes, then churn it so
+    // splits reuse records out of address order
+    PhysicalMemory pm(kBlocks * kBlockSize, AllocationStrategy::FIRST_FIT);
+    std::vector<BlockHandle> ids;
+    for (std::size_t i = 0; i < kBlocks; ++i) {
+        ids.push_back(pm.allocate(kBlockSize));
+    }
+    for (std::size_t i = 0; i < ids.size(); i += 2) {
+        pm.free_block(ids[i]);
+    }
+    for (std::size_t i = 0; i < kBlocks / 4; ++i) {
+        BlockHandle id = pm.allocate(1 + rng() % (kBlockSize - 1));
+        if (id != -1) {
+            pm.free_block(ids[1 + 2 * (rng() % (ids.size() / 2))]);
+        }
+    }
+
+    std::vector<MemoryBlock> layout;
+    pm.for_each_block([&](const MemoryBlock& block) { layout.push_back(block); });
+
+    // Baseline: same blocks in a std::list, nodes allocated in shuffled order
+    std::vector<std::size_t> order(layout.size());
+    for (std::size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::shuffle(order.begin(), order.end(), rng);
+
+    // Nodes are created in shuffled order; sort() only relinks them, so the
+    // list is back in address order but its nodes stay scattered
+    std::list<MemoryBlock> list;
+    for (std::size_t i : order) {
+        list.push_back(layout[i]);
+    }
+    list.sort([](const MemoryBlock& a, const MemoryBlock& b) { return a.start < b.start; });
+
+    std::cout << "PhysicalMemory scan benchmark (" << layout.size() << " blocks, "
+              << kPasses << " passes)\n";
+
+    ScanResult before{0, 0};
+    double list_seconds = time_scans([&]() {
+        ScanResult r{0, 0};
+        for (const MemoryBlock& block : list) {
+            if (block.free) {
+                r.free_bytes += block.size;
+                ++r.free_blocks;
+            }
+        }
+        return r;
+    }, before);
+
+    ScanResult after{0, 0};
+    double slab_seconds = time_scans([&]() {
+        ScanResult r{0, 0};
+        pm.for_each_block([&](const MemoryBlock& block) {
+            if (block.free) {
+                r.free_bytes += block.size;
+                ++r.free_blocks;
+            }
+        });
+        return r;
+    }, after);
+
+    report("before (std::list)", list_seconds, layout.size());
+    report("after (index-linked slab)", slab_seconds, layout.size());
+
+    if (before.free_bytes != after.free_bytes || before.free_blocks != after.free_blocks ||
+        after.free_bytes != pm.free_memory()) {
+        std::cerr << "Scan results differ\n";
+        return 1;
+    }
+
+    std::cout << "  speedup: " << std::setprecision(2) << list_seconds / slab_seconds << "x\n";
+    return 0;
+}
@@ -0,0 +1,43 @@
+#ifndef BIT_UTILS_H
+#define BIT_UTILS_H
+
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/**
+ * Portable bit-scan helpers shared by the allocators.
+ * The bit scans require a non-zero argument.
+ */
+inline unsigned count_trailing_zeros(std::uint64_t x) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, x);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctzll(x));
+#endif
+}
+
+inline unsigned floor_log2(std::uint64_t x) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, x);
+    return static_cast<unsigned>(index);
+#else
+    return 63u - static_cast<unsigned>(__builtin_clzll(x));
+#endif
+}
+
+inline bool is_power_of_two(std::uint64_t x) {
+    return x != 0 && (x & (x - 1)) == 0;
+}
+
+// Rounds x up to a multiple of a power-of-two alignment
+inline std::uint64_t align_up(std::uint64_t x, std::uint64_t alignment) {
+    return (x + alignment - 1) & ~(alignment - 1);
+}
+
+#endif // BIT_UTILS_H
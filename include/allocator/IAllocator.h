@@ -1,8 +1,15 @@
 #ifndef IALLOCATOR_H
 #define IALLOCATOR_H
 
+#include "SlotMap.h"
 #include <cstddef>
 
+struct ReallocStats {
+    std::size_t in_place;  // resized without moving
+    std::size_t moved;     // copied to a new block under the same handle
+    std::size_t failed;    // left untouched because no block was large enough
+};
+
 /**
  * Abstract interface for memory allocators
  * Provides a common interface for different allocation strategies
@@ -12,15 +19,63 @@ public:
     virtual ~IAllocator() = default;
     
     // Core allocation functions
-    virtual int allocate(std::size_t size) = 0;
-    virtual void free_block(int id) = 0;
+    // Handles are generational slot-map handles; kInvalidHandle (-1) on failure
+    virtual BlockHandle allocate(std::size_t size) = 0;
+    // Block starting at a multiple of `alignment`, which must be a power
+    // of two; kInvalidHandle if it is not or the request cannot be placed
+    virtual BlockHandle allocate_aligned(std::size_t size, std::size_t alignment) = 0;
+    virtual void free_block(BlockHandle id) = 0;
+    // Grows or shrinks a live block, in place when the allocator can and
+    // by moving it otherwise. The handle stays valid either way; on
+    // failure (false) the block is unchanged.
+    virtual bool reallocate(BlockHandle id, std::size_t new_size) = 0;
+    virtual const ReallocStats& realloc_stats() const = 0;
+
+    // Batched forms: one call for `count` requests. out[i] receives the
+    // handle for sizes[i] (kInvalidHandle where it failed); returns the
+    // number that succeeded. The defaults loop; allocators override them
+    // to share one search among several requests.
+    virtual std::size_t allocate_batch(const std::size_t* sizes, std::size_t count,
+                                       BlockHandle* out) {
+        std::size_t allocated = 0;
+        for (std::size_t i = 0; i < count; ++i) {
+            out[i] = allocate(sizes[i]);
+            allocated += out[i] != kInvalidHandle ? 1 : 0;
+        }
+        return allocated;
+    }
+
+    virtual void free_batch(const BlockHandle* ids, std::size_t count) {
+        for (std::size_t i = 0; i < count; ++i) {
+            free_block(ids[i]);
+        }
+    }
+
+    // Start address of a live block, or (size_t)-1 if the handle is not allocated
+    virtual std::size_t block_start(BlockHandle id) const = 0;
     
     // Memory information
     virtual std::size_t total_memory() const = 0;
     virtual std::size_t used_memory() const = 0;
     virtual std::size_t free_memory() const = 0;
     virtual std::size_t largest_free_block() const = 0;
+    virtual std::size_t live_allocations() const = 0;
+
+    // 1 - largest free block / total free memory; O(1) when the
+    // counters above are maintained incrementally
+    virtual double external_fragmentation() const {
+        std::size_t free_mem = free_memory();
+        if (free_mem == 0) {
+            return 0.0;
+        }
+        return 1.0 - static_cast<double>(largest_free_block()) /
+                     static_cast<double>(free_mem);
+    }
     
+    // Consistency of the allocator's internal structures; cheap enough
+    // (O(blocks log blocks)) to run every few operations in soak tests
+    virtual bool check_invariants() const = 0;
+
     // Visualization
     virtual void dump() const = 0;
     
@@ -2,21 +2,46 @@
 #define PHYSICAL_MEMORY_H
 
 #include "IAllocator.h"
+#include "SlotMap.h"
 #include <cstddef>
-#include <list>
+#include <cstdint>
+#include <map>
 #include <string>
+#include <utility>
+#include <vector>
 
 struct MemoryBlock {
     std::size_t start;
     std::size_t size;
     bool free;
-    int id;
+    BlockHandle id;
+    std::size_t alignment = 1;  // kept by compaction; 1 unless allocated aligned
 };
 
 enum class AllocationStrategy {
     FIRST_FIT,
     BEST_FIT,
-    WORST_FIT
+    WORST_FIT,
+    NEXT_FIT
+};
+
+// When PhysicalMemory compacts on its own; compact() can always be called
+enum class CompactionPolicy {
+    MANUAL,      // only explicit compact() calls
+    ON_DEMAND,   // after an allocation fails although free memory would cover it
+    BACKGROUND   // also after a free leaves external fragmentation above a threshold
+};
+
+struct CompactionResult {
+    std::map<std::size_t, std::size_t> relocations;  // old start -> new start
+    std::size_t bytes_moved;
+};
+
+struct CompactionStats {
+    std::size_t passes;
+    std::size_t blocks_moved;
+    std::size_t bytes_moved;
+    std::size_t failures_avoided;  // allocations that only succeeded after compacting
 };
 
 class PhysicalMemory : public IAllocator {
@@ -24,33 +49,132 @@ public:
     explicit PhysicalMemory(std::size_t total_size, AllocationStrategy strategy = AllocationStrategy::FIRST_FIT);
 
     // Allocation strategies
-    int allocate_first_fit(std::size_t size);
-    int allocate_best_fit(std::size_t size);
-    int allocate_worst_fit(std::size_t size);
+    BlockHandle allocate_first_fit(std::size_t size);
+    BlockHandle allocate_best_fit(std::size_t size);
+    BlockHandle allocate_worst_fit(std::size_t size);
+    BlockHandle allocate_next_fit(std::size_t size);
 
     // Strategy management
     void set_strategy(AllocationStrategy strategy);
     AllocationStrategy get_strategy() const;
 
     // IAllocator interface implementation
-    int allocate(std::size_t size) override;
-    void free_block(int id) override;
+    BlockHandle allocate(std::size_t size) override;
+    // Uses the current strategy among holes that fit once aligned; the
+    // leading padding stays behind as a free block
+    BlockHandle allocate_aligned(std::size_t size, std::size_t alignment) override;
+    void free_block(BlockHandle id) override;
+    // Shrinks by splitting off the tail, grows into a free right neighbour,
+    // and otherwise moves the block using the current strategy
+    bool reallocate(BlockHandle id, std::size_t new_size) override;
+    const ReallocStats& realloc_stats() const override;
+    // Runs of equal sizes are carved back to back out of each hole the
+    // strategy picks, so a run costs one search per hole rather than one
+    // per block. Worst fit stops carving a hole once single calls would
+    // move to the next-largest one, so placement matches allocate().
+    // Whatever the holes cannot serve falls back to allocate()
+    std::size_t allocate_batch(const std::size_t* sizes, std::size_t count,
+                               BlockHandle* out) override;
+    // Frees every block, then checks the background compaction threshold once
+    void free_batch(const BlockHandle* ids, std::size_t count) override;
     std::size_t total_memory() const override;
     std::size_t used_memory() const override;
     std::size_t free_memory() const override;
     std::size_t largest_free_block() const override;
+    std::size_t live_allocations() const override;
+    bool check_invariants() const override;
     void dump() const override;
     const char* allocator_name() const override;
 
-    // Additional functionality
-    double external_fragmentation() const;
+    // Start address of a live block, or (size_t)-1 if the id is not allocated
+    std::size_t block_start(BlockHandle id) const override;
+
+    // Slides every used block down to the lowest free address, leaving one
+    // free block at the top. Handles stay valid; only block starts change.
+    CompactionResult compact();
+    void set_compaction_policy(CompactionPolicy policy, double fragmentation_threshold = 0.5);
+    CompactionPolicy compaction_policy() const;
+    const CompactionStats& compaction_stats() const;
+    // Relocations made by the most recent pass, including automatic ones
+    const CompactionResult& last_compaction() const;
+
+    // Visit every block (free and used) in address order
+    template <typename Fn>
+    void for_each_block(Fn&& fn) const {
+        for (BlockRef ref = head_; ref != kNil; ref = records_[ref].next) {
+            fn(records_[ref].block);
+        }
+    }
 
 private:
+    // Blocks live in a slab of records linked by index in address order.
+    // Records merged away go to a free pool and are reused by later splits,
+    // so steady-state allocation never touches the host heap.
+    using BlockRef = std::uint32_t;
+    static constexpr BlockRef kNil = UINT32_MAX;
+
+    struct BlockRecord {
+        MemoryBlock block;
+        BlockRef prev;
+        BlockRef next;
+    };
+
+    // Segregated free index: sizes below kExactBins get one bin each,
+    // larger sizes share a bin per power of two. Each bin is ordered by
+    // start address so first fit keeps its lowest-address choice.
+    static constexpr std::size_t kExactBins = 64;
+    static constexpr std::size_t kNumBins = kExactBins + 58;
+    static constexpr std::size_t kBitmapWords = (kNumBins + 63) / 64;
+
     std::size_t total_size_;
-    std::list<MemoryBlock> blocks_;
-    int next_id_;
+    std::vector<BlockRecord> records_;
+    std::vector<BlockRef> free_records_;
+    BlockRef head_;
     AllocationStrategy strategy_;
-    int allocate_from_block(std::list<MemoryBlock>::iterator it, std::size_t size);
+    std::size_t used_bytes_;
+
+    // Next fit resumes here; moved onto the surviving block when merged away
+    BlockRef rover_;
+
+    // Live block handle -> record; records of used blocks never move on
+    // splits, merges or compaction
+    SlotMap<BlockRef> live_blocks_;
+
+    CompactionPolicy compaction_policy_;
+    double fragmentation_threshold_;
+    CompactionStats compaction_stats_;
+    CompactionResult last_compaction_;
+
+    ReallocStats realloc_stats_;
+
+    std::vector<std::map<std::size_t, BlockRef>> free_bins_;
+    std::uint64_t bin_bitmap_[kBitmapWords];
+
+    // The same free blocks ordered by (size, start): best fit is a
+    // lower_bound, worst fit and the largest hole sit at the back
+    std::map<std::pair<std::size_t, std::size_t>, BlockRef> free_by_size_;
+
+    MemoryBlock& block(BlockRef ref) { return records_[ref].block; }
+    BlockRef new_record(const MemoryBlock& block);
+    void insert_before(BlockRef pos, BlockRef ref);
+    void unlink(BlockRef ref);
+
+    BlockHandle allocate_with_strategy(std::size_t size);
+    BlockHandle allocate_aligned_with_strategy(std::size_t size, std::size_t alignment);
+    BlockHandle allocate_from_block(BlockRef ref, std::size_t size);
+    BlockHandle allocate_from_block_aligned(BlockRef ref, std::size_t size, std::size_t alignment);
+    BlockRef find_hole(std::size_t size);
+    std::size_t worst_fit_run(BlockRef hole, std::size_t size) const;
+    void carve_blocks(BlockRef ref, std::size_t size, std::size_t count, BlockHandle* out);
+    bool release_block(BlockHandle id);
+    BlockRef find_first_fit(std::size_t size, std::size_t from_addr);
+    BlockRef find_first_fit_aligned(std::size_t size, std::size_t alignment, std::size_t from_addr);
+    bool fits_aligned(BlockRef ref, std::size_t size, std::size_t alignment) const;
+
+    static std::size_t size_class(std::size_t size);
+    void index_free(BlockRef ref);
+    void unindex_free(BlockRef ref);
+    std::size_t next_nonempty_bin(std::size_t from) const;
 };
 
 #endif
@@ -0,0 +1,133 @@
+#ifndef SLOT_MAP_H
+#define SLOT_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Allocation handle shared by every allocator.
+ *
+ * The low 32 bits hold slot index + 1 and the high bits the slot's
+ * generation, so the first handles are 1, 2, 3, ... and a freed handle
+ * never matches the slot's next occupant. -1 means "no block".
+ */
+using BlockHandle = std::int64_t;
+
+constexpr BlockHandle kInvalidHandle = -1;
+
+inline std::uint32_t handle_index(BlockHandle handle) {
+    return static_cast<std::uint32_t>(handle & 0xFFFFFFFF) - 1;
+}
+
+inline std::uint32_t handle_generation(BlockHandle handle) {
+    return static_cast<std::uint32_t>(static_cast<std::uint64_t>(handle) >> 32);
+}
+
+/**
+ * Dense generational slot map: values live in one array indexed by the
+ * handle, so insert, erase and lookup are O(1) array operations with no
+ * hashing. Erased slots are reused after bumping their generation.
+ */
+template <typename T>
+class SlotMap {
+public:
+    SlotMap() : size_(0) {}
+
+    BlockHandle insert(const T& value) {
+        std::uint32_t index;
+        if (!free_slots_.empty()) {
+            index = free_slots_.back();
+            free_slots_.pop_back();
+        } else {
+            index = static_cast<std::uint32_t>(slots_.size());
+            slots_.emplace_back();
+        }
+
+        Slot& slot = slots_[index];
+        slot.value = value;
+        slot.occupied = true;
+        ++size_;
+        return make_handle(index, slot.generation);
+    }
+
+    // Returns false for stale or unknown handles
+    bool erase(BlockHandle handle) {
+        Slot* slot = lookup(handle);
+        if (slot == nullptr) {
+            return false;
+        }
+        slot->occupied = false;
+        // 31 generation bits keep handles positive; a slot would need
+        // 2^31 reuses before an old handle could match again
+        slot->generation = (slot->generation + 1) & 0x7FFFFFFF;
+        free_slots_.push_back(handle_index(handle));
+        --size_;
+        return true;
+    }
+
+    T* find(BlockHandle handle) {
+        Slot* slot = lookup(handle);
+        return slot == nullptr ? nullptr : &slot->value;
+    }
+
+    const T* find(BlockHandle handle) const {
+        const Slot* slot = const_cast<SlotMap*>(this)->lookup(handle);
+        return slot == nullptr ? nullptr : &slot->value;
+    }
+
+    bool contains(BlockHandle handle) const {
+        return find(handle) != nullptr;
+    }
+
+    std::size_t size() const {
+        return size_;
+    }
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    // Visit live entries in slot order as fn(handle, value)
+    template <typename Fn>
+    void for_each(Fn&& fn) const {
+        for (std::uint32_t index = 0; index < slots_.size(); ++index) {
+            if (slots_[index].occupied) {
+                fn(make_handle(index, slots_[index].generation), slots_[index].value);
+            }
+        }
+    }
+
+private:
+    struct Slot {
+        T value{};
+        std::uint32_t generation = 0;
+        bool occupied = false;
+    };
+
+    std::vector<Slot> slots_;
+    std::vector<std::uint32_t> free_slots_;
+    std::size_t size_;
+
+    static BlockHandle make_handle(std::uint32_t index, std::uint32_t generation) {
+        return static_cast<BlockHandle>((static_cast<std::uint64_t>(generation) << 32) |
+                                        (static_cast<std::uint64_t>(index) + 1));
+    }
+
+    Slot* lookup(BlockHandle handle) {
+        if (handle <= 0) {
+            return nullptr;
+        }
+        std::uint32_t index = handle_index(handle);
+        if (index >= slots_.size()) {
+            return nullptr;
+        }
+        Slot& slot = slots_[index];
+        if (!slot.occupied || slot.generation != handle_generation(handle)) {
+            return nullptr;
+        }
+        return &slot;
+    }
+};
+
+#endif // SLOT_MAP_H
@@ -1,34 +1,134 @@
 #pragma once
 
 #include "../allocator/IAllocator.h"
+#include "../allocator/SlotMap.h"
 #include <cstddef>
+#include <cstdint>
 #include <vector>
 #include <list>
 #include <unordered_map>
 
+enum class CoalescingMode {
+    EAGER,  // free_buddy merges as far up as it can
+    LAZY    // freed blocks stay at their order until pressure or a watermark
+};
+
+// Mobility classes; each pageblock holds blocks of one class where possible
+enum class MigrateType {
+    UNMOVABLE,    // long-lived, pinned (kernel structures)
+    MOVABLE,      // can be migrated or compacted (user pages)
+    RECLAIMABLE   // can be dropped under pressure (caches)
+};
+
+/**
+ * Binary buddy allocator.
+ *
+ * Memory of any size is carved into maximal aligned power-of-two top-level
+ * blocks (like the zones of a real kernel), so a 48 MiB pool is a 32 MiB
+ * and a 16 MiB tree rather than a padded 64 MiB one. Blocks split in
+ * halves on allocation and merge with their buddy on free, but never
+ * across a top-level boundary or past the end of memory.
+ *
+ * In LAZY mode a freed block is left at its own order, so the next
+ * request of that size reuses it without a split. Deferred blocks are
+ * merged once more than `lazy_watermark` of them are waiting (each
+ * further free then merges eagerly), or all at once when an allocation
+ * would otherwise fail. largest_free_block() reports what is on the free
+ * lists, which in LAZY mode can be less than coalesce() would produce.
+ *
+ * Memory is grouped into pageblocks of 2^pageblock_order bytes, each owned
+ * by one MigrateType, with separate free lists per type. A request is
+ * served from its own type's pageblocks first. When those are exhausted
+ * it falls back to another type, taking that type's smallest whole free
+ * pageblock if it has one and its largest smaller block otherwise, and
+ * claims whole pageblocks where it can, so long-lived and short-lived
+ * allocations stay apart and high-order blocks survive longer. All
+ * pageblocks start MOVABLE, which is also the default type, so untyped
+ * use behaves exactly like a plain buddy allocator.
+ */
 class BuddyAllocator : public IAllocator {
 public:
-    explicit BuddyAllocator(std::size_t total_memory);
+    struct CoalescingStats {
+        std::size_t splits;
+        std::size_t merges;
+        std::size_t list_ops;         // free-list pushes and removals
+        std::size_t deferred_frees;   // frees that skipped the merge walk
+        std::size_t deferred_reuses;  // allocations served by a deferred block
+        std::size_t coalesce_passes;  // full merges of every deferred block
+    };
+
+    struct MobilityStats {
+        std::size_t fallbacks;             // served from another type's pageblocks
+        std::size_t pageblocks_claimed;    // pageblocks that changed type on a fallback
+        std::size_t high_order_attempts;   // requests of a pageblock or more
+        std::size_t high_order_successes;
+    };
+
+    // High-order success rate is sampled once per this many high-order requests
+    static constexpr std::size_t kHighOrderWindow = 100;
+
+    explicit BuddyAllocator(std::size_t total_memory,
+                            CoalescingMode mode = CoalescingMode::EAGER,
+                            std::size_t lazy_watermark = 256);
     
     // Original buddy-specific methods (return addresses)
-    std::size_t allocate_buddy(std::size_t size);
+    std::size_t allocate_buddy(std::size_t size, MigrateType type = MigrateType::MOVABLE);
+    std::size_t allocate_buddy_aligned(std::size_t size, std::size_t alignment,
+                                       MigrateType type = MigrateType::MOVABLE);
     void free_buddy(std::size_t addr);
+    // New start of the resized block (addr itself if it stayed), or (size_t)-1
+    std::size_t reallocate_buddy(std::size_t addr, std::size_t new_size);
+
+    // Handle-based allocation with an explicit mobility class
+    BlockHandle allocate(std::size_t size, MigrateType type);
 
     // IAllocator interface implementation (uses block IDs)
-    int allocate(std::size_t size) override;
-    void free_block(int id) override;
+    BlockHandle allocate(std::size_t size) override;
+    BlockHandle allocate_aligned(std::size_t size, std::size_t alignment) override;
+    void free_block(BlockHandle id) override;
+    // Shrinks by splitting, grows by absorbing free buddies while the block
+    // is the lower half of each pair, and otherwise moves
+    bool reallocate(BlockHandle id, std::size_t new_size) override;
+    const ReallocStats& realloc_stats() const override;
+    // Consecutive requests of the same order take free blocks of exactly
+    // that order first; the rest of a run of k splits a single block of
+    // order + ceil(log2 k) k ways
+    std::size_t allocate_batch(const std::size_t* sizes, std::size_t count,
+                               BlockHandle* out) override;
     std::size_t total_memory() const override;
     std::size_t used_memory() const override;
     std::size_t free_memory() const override;
     std::size_t largest_free_block() const override;
+    std::size_t live_allocations() const override;
+    bool check_invariants() const override;
     void dump() const override;
     const char* allocator_name() const override;
 
+    // Merge every deferred block as far as it goes; returns merges done
+    std::size_t coalesce();
+    CoalescingMode coalescing_mode() const;
+    std::size_t deferred_blocks() const;
+    const CoalescingStats& coalescing_stats() const;
+
+    // Start address of a live block, or (size_t)-1 if the handle is not allocated
+    std::size_t block_start(BlockHandle id) const override;
+
+    // Pageblock size used for mobility grouping; only changeable while
+    // nothing is allocated. Returns false if the change was refused.
+    bool set_pageblock_order(std::size_t order);
+    std::size_t pageblock_order() const;
+    MigrateType pageblock_type(std::size_t addr) const;
+    const MobilityStats& mobility_stats() const;
+    double high_order_success_rate() const;
+    // Success rate of each completed window of kHighOrderWindow high-order requests
+    const std::vector<double>& high_order_history() const;
+
     // Metrics and analysis
     std::size_t allocated_memory() const;
     double internal_fragmentation() const;
 
-    // Invariant checks (debug / analysis)
+    // Invariant checks (debug / analysis), O(blocks log blocks); free
+    // buddy pairs are only an error in EAGER mode
     bool check_no_free_buddy_pairs() const;
     bool check_no_overlaps() const;
 
@@ -38,17 +138,78 @@ private:
     std::size_t total_memory_;
     std::size_t max_order_;
 
-    // free_lists_[k] holds starting addresses of free blocks of size 2^k
-    std::vector<std::list<std::size_t>> free_lists_;
+    static constexpr std::size_t kMigrateTypes = 3;
+    // 4 KiB pageblocks unless memory is smaller
+    static constexpr std::size_t kDefaultPageblockOrder = 12;
 
-    // address -> order (used later for free)
-    std::unordered_map<std::size_t, std::size_t> allocated_blocks_;
+    // free_lists_[t][k] holds starting addresses of free blocks of size 2^k
+    // whose first pageblock belongs to migrate type t
+    std::vector<std::list<std::size_t>> free_lists_[kMigrateTypes];
+
+    std::size_t pageblock_order_;
+    std::vector<std::uint8_t> pageblock_types_;
+
+    // Free state per address: which order's list the block is on and where.
+    // Plays the role of Linux's per-order free bitmaps (is the buddy free at
+    // this order?) and gives O(1) removal from the middle of a free list.
+    // It is keyed by address rather than dense, since order 0 is one byte
+    // and a dense map would cost O(total memory) host bits.
+    struct FreeEntry {
+        std::size_t order;
+        std::list<std::size_t>::iterator pos;
+        bool deferred;  // freed in LAZY mode without looking for its buddy
+        std::uint8_t type;
+    };
+    std::unordered_map<std::size_t, FreeEntry> free_index_;
+
+    // Bit k set <=> free_lists_[t][k] is non-empty
+    std::uint64_t nonempty_orders_[kMigrateTypes];
+
+    struct AllocatedBlock {
+        std::size_t order;
+        std::size_t requested;  // bytes asked for, before rounding
+        // Kept so a moving reallocate_buddy asks for the same again
+        std::size_t alignment;
+        MigrateType type;
+    };
+
+    // address -> block info (used later for free)
+    std::unordered_map<std::size_t, AllocatedBlock> allocated_blocks_;
+
+    // Running totals so the metrics never walk allocated_blocks_
+    std::size_t allocated_bytes_;
+    std::size_t requested_bytes_;
     
-    // Map block IDs to addresses for interface compliance
-    std::unordered_map<int, std::size_t> id_to_addr_;
-    std::unordered_map<std::size_t, int> addr_to_id_;
-    int next_id_;
+    // Handles from the IAllocator interface -> block address
+    SlotMap<std::size_t> handles_;
+
+    CoalescingMode mode_;
+    std::size_t lazy_watermark_;
+    std::size_t deferred_blocks_;
+    CoalescingStats stats_;
+
+    ReallocStats realloc_stats_;
+
+    MobilityStats mobility_;
+    std::vector<double> high_order_history_;
+    std::size_t window_attempts_;
+    std::size_t window_successes_;
+
+    void push_free(std::size_t addr, std::size_t order, bool deferred = false);
+    bool take_free(std::size_t addr, std::size_t order);
+    void relink_free(std::unordered_map<std::size_t, FreeEntry>::iterator it);
+    bool forget_free(std::unordered_map<std::size_t, FreeEntry>::iterator it);
+    void merge_and_push(std::size_t addr, std::size_t order);
+
+    std::uint64_t all_nonempty_orders() const;
+    bool find_free_block(std::size_t order, MigrateType type,
+                         std::size_t& addr, std::size_t& found_order);
+    std::size_t steal_block(std::size_t addr, std::size_t order,
+                            std::size_t target_order, MigrateType type);
+    void claim_pageblock(std::size_t pageblock, MigrateType type);
+    void record_high_order(bool success);
+    std::size_t allocate_run(const std::size_t* sizes, std::size_t count,
+                             std::size_t order, BlockHandle* out);
 
-    static bool is_power_of_two(std::size_t x);
     static std::size_t log2_exact(std::size_t x);
 };
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "BuddyAllocator.h"
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+struct PageCacheConfig {
+    unsigned cpus = 4;
+    std::size_t page_size = 4096;  // bytes in an order-0 frame
+    unsigned max_cached_order = 3; // orders 0..max_cached_order use the caches
+    std::size_t high = 64;         // frames a list may hold before it drains
+    std::size_t batch = 16;        // frames moved per refill or drain
+};
+
+/**
+ * Per-CPU page-frame caches in front of a BuddyAllocator (Linux pcp lists).
+ *
+ * Each CPU keeps one list per low order. Allocations pop from the hot end
+ * of the caller's list and frees push back onto it, so most low-order
+ * traffic never touches the buddy free lists or its split/merge path.
+ * An empty list is refilled with `batch` frames, and a list above `high`
+ * drains its `batch` coldest frames back to the buddy. Only refills,
+ * drains and orders above max_cached_order take the zone lock; the fast
+ * path locks just the CPU's own list, so workers on different CPUs
+ * allocate concurrently.
+ *
+ * Cached frames stay allocated as far as the buddy allocator is concerned.
+ * The zone must outlive the cache; the destructor drains every list.
+ */
+class PerCpuPageCache {
+public:
+    struct CpuStats {
+        std::size_t alloc_hits;    // served from the CPU's list
+        std::size_t alloc_misses;  // needed a refill from the buddy
+        std::size_t frees;
+        std::size_t refills;
+        std::size_t drains;
+        std::size_t cached_frames;
+
+        double hit_rate() const;
+    };
+
+    PerCpuPageCache(BuddyAllocator& zone, const PageCacheConfig& config = PageCacheConfig());
+    ~PerCpuPageCache();
+
+    PerCpuPageCache(const PerCpuPageCache&) = delete;
+    PerCpuPageCache& operator=(const PerCpuPageCache&) = delete;
+
+    // Address of a (page_size << order)-byte block, or (size_t)-1 on failure
+    std::size_t alloc_pages(unsigned cpu, unsigned order);
+    // Cold frees go to the tail of the list and are the first to drain
+    void free_pages(unsigned cpu, std::size_t addr, unsigned order, bool cold = false);
+
+    // Return every cached frame to the buddy allocator
+    void drain_all();
+
+    CpuStats cpu_stats(unsigned cpu) const;
+    std::size_t cached_frames() const;
+    const PageCacheConfig& config() const;
+
+    void dump_stats() const;
+
+private:
+    struct alignas(64) CpuCache {
+        mutable std::mutex lock;
+        std::vector<std::deque<std::size_t>> lists;  // front = hot, back = cold
+        std::size_t alloc_hits = 0;
+        std::size_t alloc_misses = 0;
+        std::size_t frees = 0;
+        std::size_t refills = 0;
+        std::size_t drains = 0;
+    };
+
+    BuddyAllocator& zone_;
+    std::mutex zone_lock_;
+    PageCacheConfig config_;
+    std::vector<CpuCache> cpus_;
+
+    std::size_t block_bytes(unsigned order) const;
+    bool refill(std::deque<std::size_t>& list, unsigned order);
+    void drain(std::deque<std::size_t>& list, std::size_t count);
+};
@@ -71,12 +71,33 @@
 #include <cstddef>
 #include <cstdint>
 
+// Data moved between the levels. Line fills and writebacks move whole
+// lines; a written-through store moves kStoreBytes.
+struct CacheTraffic {
+    std::size_t l1_writebacks;       // dirty L1 lines written to L2
+    std::size_t l2_writebacks;       // dirty L2 lines written to memory
+    std::size_t l2_to_l1_bytes;      // L1 fills
+    std::size_t l1_to_l2_bytes;      // L1 writebacks and written-through stores
+    std::size_t memory_to_l2_bytes;  // L2 fills
+    std::size_t l2_to_memory_bytes;  // L2 writebacks and written-through stores
+};
+
 class CacheHierarchy {
 public:
+    static constexpr std::size_t kStoreBytes = 8;
+
     CacheHierarchy(DirectMappedCache l1,
                    DirectMappedCache l2);
 
-    bool access(std::uint64_t physical_address);
+    // True on a hit in either level. Each cache applies its own write
+    // policy; L2 hit/miss counts only include L1 misses.
+    bool access(std::uint64_t physical_address, AccessType type = AccessType::READ);
+
+    // Same as n calls to access(), in order, storing the level that served
+    // each one. The sets both levels will look at are prefetched a block
+    // ahead. Returns the accesses that hit in either level.
+    std::size_t access_batch(const std::uint64_t* addrs, std::size_t n, HitLevel* out,
+                             AccessType type = AccessType::READ);
 
     std::size_t l1_hits() const;
     std::size_t l1_misses() const;
@@ -84,7 +105,14 @@ public:
     std::size_t l2_hits() const;
     std::size_t l2_misses() const;
 
+    const CacheTraffic& traffic() const;
+
 private:
     DirectMappedCache l1_;
     DirectMappedCache l2_;
+    CacheTraffic traffic_;
+
+    HitLevel access_level(std::uint64_t physical_address, AccessType type);
+    void write_to_l2(std::uint64_t physical_address, std::size_t bytes);
+    void account_l2(const AccessOutcome& outcome, std::size_t write_bytes, bool needs_fill);
 };
@@ -10,42 +10,161 @@ struct CacheAddress {
     std::size_t offset;
 };
 
-struct CacheLine {
-    bool valid;
-    std::uint64_t tag;
-    std::uint64_t inserted_at;
-    CacheLine() : valid(false), tag(0), inserted_at(0) {}
+// Which valid line a full set gives up. Invalid lines are always used first.
+enum class ReplacementPolicy {
+    FIFO,       // oldest fill, hits do not count
+    LRU,        // least recently used, exact recency rank per line
+    TREE_PLRU,  // binary tree of associativity - 1 bits per set; power-of-two ways
+    RANDOM      // uniformly random way, fixed seed for repeatable runs
+};
+
+// Instruction fetches behave like reads; the type is kept for the caller
+enum class AccessType {
+    READ,
+    WRITE,
+    IFETCH
+};
+
+// Where a write hit goes: held as a dirty line, or passed straight on
+enum class WritePolicy {
+    WRITE_BACK,
+    WRITE_THROUGH
+};
+
+// Whether a write miss installs the line or only passes the write on
+enum class WriteMissPolicy {
+    WRITE_ALLOCATE,
+    NO_WRITE_ALLOCATE
+};
+
+// What one access did besides hit or miss, for the level below
+struct AccessOutcome {
+    bool hit;
+    bool allocated;        // a missing line was installed and has to be filled
+    bool write_through;    // the write must also reach the next level
+    bool writeback;        // a dirty victim was evicted
+    std::uint64_t writeback_address;  // first byte of the evicted line
+};
+
+// Where a batched access was served. A cache on its own reports L1 for a
+// hit and MEMORY for a miss.
+enum class HitLevel : std::uint8_t {
+    L1,
+    L2,
+    MEMORY
 };
 
 class DirectMappedCache {
 public:
+    // Sets at least this wide compare tags with SIMD when the host CPU has
+    // it; from one AVX2 vector of tags up, bench_cache_access shows a gain
+    static constexpr std::size_t kVectorLookupWays = 4;
+    // Batched accesses decode and prefetch this many addresses ahead of the
+    // ones being looked up
+    static constexpr std::size_t kBatchBlock = 16;
+
     DirectMappedCache(std::size_t cache_size_bytes,
                       std::size_t line_size_bytes,
-                      std::size_t associativity = 1);
+                      std::size_t associativity = 1,
+                      ReplacementPolicy policy = ReplacementPolicy::FIFO);
 
     std::size_t num_sets() const;
+    ReplacementPolicy replacement_policy() const;
+
+    // Write handling; defaults to write-back with write-allocate
+    void set_write_policy(WritePolicy policy,
+                          WriteMissPolicy miss_policy = WriteMissPolicy::WRITE_ALLOCATE);
+    WritePolicy write_policy() const;
+    WriteMissPolicy write_miss_policy() const;
+    std::size_t line_size() const;
+
+    // Tag compare used for lookups: "avx2", "sse4.1" or "scalar". The SIMD
+    // kernel is picked at run time from what the host CPU supports;
+    // set_vectorized_lookup overrides the kVectorLookupWays default.
+    const char* lookup_kernel() const;
+    void set_vectorized_lookup(bool enabled);
 
     CacheAddress decode_address(std::uint64_t physical_address) const;
-    bool access(std::uint64_t physical_address);
-    void fill(std::uint64_t physical_address);
+    bool access(std::uint64_t physical_address, AccessType type = AccessType::READ);
+    AccessOutcome access_outcome(std::uint64_t physical_address, AccessType type);
+    // A write arriving from the level above (a writeback or a written-through
+    // store); handled like a write access but not counted as a hit or miss
+    AccessOutcome absorb_write(std::uint64_t physical_address);
+    // Installs the line clean; a line already present only has its recency
+    // refreshed
+    AccessOutcome fill(std::uint64_t physical_address);
+
+    // Same results and counts as n calls to access(), in order. Set indices
+    // are decoded a block at a time and the sets of the next block are
+    // prefetched while the current one is looked up. Returns the hits.
+    std::size_t access_batch(const std::uint64_t* addrs, std::size_t n, HitLevel* out,
+                             AccessType type = AccessType::READ);
+    // Prefetches the host memory of the sets these addresses map to
+    void prefetch_sets(const std::uint64_t* addrs, std::size_t n) const;
 
     std::size_t hits() const;
     std::size_t misses() const;
     double hit_ratio() const;
+    // Dirty lines evicted, and writes passed on to the next level
+    std::size_t writebacks() const;
+    std::size_t write_throughs() const;
 
 private:
     std::size_t cache_size_;
     std::size_t line_size_;
     std::size_t associativity_;
     std::size_t num_sets_;
+    ReplacementPolicy policy_;
 
     std::size_t offset_bits_;
     std::size_t index_bits_;
 
+    WritePolicy write_policy_;
+    WriteMissPolicy write_miss_policy_;
+
     std::size_t hits_;
     std::size_t misses_;
-    std::uint64_t timestamp_;
+    std::size_t writebacks_;
+    std::size_t write_throughs_;
 
-    std::vector<std::vector<CacheLine>> sets_;
-};
+    // Flat tag store: the tags of set s are tags_[s * associativity_ ..],
+    // its valid bits are valid_words_ words from valid_bits_[s * valid_words_].
+    // A lookup reads one contiguous run of tags plus one valid word.
+    // Dirty bits use the same layout as the valid bits.
+    std::vector<std::uint64_t> tags_;
+    std::size_t valid_words_;
+    std::vector<std::uint64_t> valid_bits_;
+    std::vector<std::uint64_t> dirty_bits_;
+
+    // Bit i of the result is set when tags[i] == tag, for up to 64 tags;
+    // null means the scalar early-exit loop
+    using TagMatchFn = std::uint64_t (*)(const std::uint64_t* tags, std::size_t count,
+                                         std::uint64_t tag);
+    TagMatchFn match_tags_;
 
+    // Replacement state, sized for the selected policy only.
+    // FIFO: next way to replace in each set
+    std::vector<std::uint32_t> fifo_next_;
+    // LRU: recency rank of each line, 0 = most recent; each set holds a
+    // permutation of 0 .. associativity - 1
+    std::vector<std::uint16_t> lru_rank_;
+    // Tree-PLRU: node i of a set's tree is bit i - 1, set when the victim
+    // path goes right; plru_words_ words per set
+    std::size_t plru_words_;
+    std::vector<std::uint64_t> plru_bits_;
+    // With one word per set, touching a way rewrites the bits on its path:
+    // bits = (bits & ~plru_path_mask_[way]) | plru_path_bits_[way]
+    std::vector<std::uint64_t> plru_path_mask_;
+    std::vector<std::uint64_t> plru_path_bits_;
+    std::uint64_t rng_state_;
+
+    std::size_t find_way(std::size_t set_index, std::uint64_t tag) const;
+    std::size_t choose_victim(std::size_t set_index);
+    void touch(std::size_t set_index, std::size_t way);
+    void install(std::size_t set_index, std::size_t way, std::uint64_t tag);
+    void evict(std::size_t set_index, std::size_t way, AccessOutcome& outcome);
+    void prefetch_set(std::size_t set_index) const;
+    AccessOutcome lookup(std::uint64_t physical_address, AccessType type, bool demand);
+    AccessOutcome lookup_set(std::size_t set_index, std::uint64_t tag, AccessType type,
+                             bool demand);
+};
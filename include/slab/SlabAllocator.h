@@ -0,0 +1,119 @@
+#pragma once
+
+#include "../allocator/IAllocator.h"
+#include "../allocator/SlotMap.h"
+#include "../buddy/BuddyAllocator.h"
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+/**
+ * Object-cache allocator layered on BuddyAllocator.
+ *
+ * Each cache serves objects of one size out of slabs, which are
+ * fixed-size runs of memory taken from the buddy allocator with
+ * allocate_buddy(). Free objects in a slab sit on an index stack, so a
+ * small-object allocate or free is a pop or a push. Slabs move between
+ * partial and empty lists as objects come and go. Empty slabs beyond
+ * a small reserve are handed back to the buddy allocator. Requests too
+ * large to fit several objects per slab go straight to the buddy
+ * allocator.
+ */
+class SlabAllocator : public IAllocator {
+public:
+    struct CacheStats {
+        std::size_t object_size;
+        std::size_t objects_per_slab;
+        std::size_t slabs;
+        std::size_t full_slabs;
+        std::size_t partial_slabs;
+        std::size_t empty_slabs;
+        std::size_t active_objects;
+        double occupancy;  // active objects / object capacity of all slabs
+    };
+
+    explicit SlabAllocator(std::size_t total_memory, std::size_t slab_size = 4096);
+
+    // Create (or look up) the cache for a given object size; returns its index
+    std::size_t create_cache(std::size_t object_size);
+
+    // Hand every empty slab back to the buddy allocator; returns bytes released
+    std::size_t reclaim();
+
+    // IAllocator interface implementation
+    BlockHandle allocate(std::size_t size) override;
+    BlockHandle allocate_aligned(std::size_t size, std::size_t alignment) override;
+    void free_block(BlockHandle id) override;
+    // Stays put while the object's slot (or buddy block) still fits, like
+    // krealloc; otherwise moves
+    bool reallocate(BlockHandle id, std::size_t new_size) override;
+    const ReallocStats& realloc_stats() const override;
+    std::size_t total_memory() const override;
+    std::size_t used_memory() const override;
+    std::size_t free_memory() const override;
+    std::size_t largest_free_block() const override;
+    std::size_t live_allocations() const override;
+    bool check_invariants() const override;
+    void dump() const override;
+    const char* allocator_name() const override;
+
+    // Metrics and analysis
+    std::vector<CacheStats> cache_stats() const;
+    double internal_fragmentation() const;
+    std::size_t block_start(BlockHandle id) const override;
+    const BuddyAllocator& backing_allocator() const;
+
+private:
+    // Objects are packed at this granularity inside a slab
+    static constexpr std::size_t kObjectAlign = 8;
+    // Smaller capacities are not worth a slab; such requests use the buddy directly
+    static constexpr std::size_t kMinObjectsPerSlab = 8;
+    // Empty slabs each cache keeps around before returning them to the buddy
+    static constexpr std::size_t kEmptySlabReserve = 1;
+
+    static constexpr std::uint32_t kNoList = UINT32_MAX;
+
+    struct Slab {
+        std::size_t addr;
+        std::vector<std::uint32_t> free_objects;  // stack of free object indices
+        std::uint32_t in_use;
+        std::uint32_t list_pos;  // position in the partial or empty list
+    };
+
+    struct Cache {
+        std::size_t object_size;
+        std::uint32_t objects_per_slab;
+        std::vector<Slab> slabs;
+        std::vector<std::uint32_t> spare_slabs;  // records of released slabs
+        std::vector<std::uint32_t> partial;
+        std::vector<std::uint32_t> empty;
+        std::size_t full_slabs;
+        std::size_t active_objects;
+    };
+
+    struct Allocation {
+        std::size_t cache;    // kLargeCache for direct buddy allocations
+        std::uint32_t slab;
+        std::uint32_t object;
+        std::size_t addr;
+        std::size_t requested;
+        std::size_t alignment;  // as asked for; a moving reallocate keeps it
+    };
+    static constexpr std::size_t kLargeCache = static_cast<std::size_t>(-1);
+
+    BuddyAllocator buddy_;
+    std::size_t slab_size_;
+    std::vector<Cache> caches_;
+    std::map<std::size_t, std::size_t> cache_by_size_;
+
+    SlotMap<Allocation> live_;
+    std::size_t requested_bytes_;
+    std::size_t slot_bytes_;  // object slots and large blocks handed out
+    ReallocStats realloc_stats_;
+
+    bool grow(Cache& cache);
+    void release_slab(Cache& cache, std::uint32_t slab);
+    static void list_remove(std::vector<std::uint32_t>& list, Cache& cache, std::uint32_t slab);
+    static void list_push(std::vector<std::uint32_t>& list, Cache& cache, std::uint32_t slab);
+};
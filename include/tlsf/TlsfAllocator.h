@@ -0,0 +1,94 @@
+#pragma once
+
+#include "../allocator/IAllocator.h"
+#include "../allocator/SlotMap.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Two-Level Segregated Fit allocator.
+ *
+ * Free blocks are kept in per-class lists indexed by a first level
+ * (power of two) and a second level (kSlCount linear subdivisions of that
+ * power of two). Two bitmaps record which lists are non-empty, so finding
+ * a suitable list is two bit scans and allocate/free run in bounded time
+ * regardless of how many blocks exist.
+ */
+class TlsfAllocator : public IAllocator {
+public:
+    explicit TlsfAllocator(std::size_t total_memory);
+
+    // IAllocator interface implementation
+    BlockHandle allocate(std::size_t size) override;
+    BlockHandle allocate_aligned(std::size_t size, std::size_t alignment) override;
+    void free_block(BlockHandle id) override;
+    // Shrinks or grows into a free next block in place, otherwise moves
+    bool reallocate(BlockHandle id, std::size_t new_size) override;
+    const ReallocStats& realloc_stats() const override;
+    std::size_t total_memory() const override;
+    std::size_t used_memory() const override;
+    std::size_t free_memory() const override;
+    // O(1): a block from the highest non-empty class, which is exact when
+    // that class holds one block and otherwise short of the largest by less
+    // than 1/kSlCount of it (sizes below kSmallBlockSize are always exact)
+    std::size_t largest_free_block() const override;
+    std::size_t live_allocations() const override;
+    bool check_invariants() const override;
+    void dump() const override;
+    const char* allocator_name() const override;
+
+    // Start address of a live block, or (size_t)-1 if the id is not allocated
+    std::size_t block_start(BlockHandle id) const override;
+
+    void dump_free_lists() const;
+
+private:
+    static constexpr unsigned kSlLog2 = 4;
+    static constexpr unsigned kSlCount = 1u << kSlLog2;
+    // Sizes below kSmallBlockSize map linearly into first-level list 0
+    static constexpr std::size_t kSmallBlockSize = kSlCount;
+    static constexpr unsigned kFlShift = kSlLog2 - 1;
+    static constexpr unsigned kFlCount = 64 - kFlShift;
+
+    using BlockRef = std::uint32_t;
+    static constexpr BlockRef kNil = UINT32_MAX;
+
+    struct Block {
+        std::size_t start;
+        std::size_t size;
+        bool free;
+        BlockHandle id;
+        std::size_t alignment;  // of a used block, so a moving reallocate keeps it
+        BlockRef prev_phys;
+        BlockRef next_phys;
+        BlockRef prev_free;
+        BlockRef next_free;
+    };
+
+    std::size_t total_memory_;
+    std::size_t used_bytes_;
+
+    std::vector<Block> blocks_;
+    std::vector<BlockRef> spare_records_;
+    BlockRef first_block_;
+
+    std::uint64_t fl_bitmap_;
+    std::uint32_t sl_bitmap_[kFlCount];
+    BlockRef heads_[kFlCount][kSlCount];
+
+    SlotMap<BlockRef> live_blocks_;
+    ReallocStats realloc_stats_;
+
+    static void mapping_insert(std::size_t size, unsigned& fl, unsigned& sl);
+    static void mapping_search(std::size_t size, unsigned& fl, unsigned& sl);
+    bool find_suitable(unsigned& fl, unsigned& sl) const;
+    BlockRef find_block(std::size_t size) const;
+    BlockHandle use_block(BlockRef ref, std::size_t size);
+    void release_tail(BlockRef ref, std::size_t size);
+
+    BlockRef new_record();
+    void release_record(BlockRef ref);
+    void insert_free(BlockRef ref);
+    void remove_free(BlockRef ref);
+};
@@ -1,23 +1,133 @@
 #include "allocator/PhysicalMemory.h"
+#include "allocator/BitUtils.h"
+#include <algorithm>
 #include <iostream>
 #include <iomanip>
+#include <iterator>
+#include <utility>
 
 PhysicalMemory::PhysicalMemory(std::size_t total_size, AllocationStrategy strategy)
-    : total_size_(total_size), next_id_(1), strategy_(strategy)
+    : total_size_(total_size), head_(kNil), strategy_(strategy), used_bytes_(0),
+      compaction_policy_(CompactionPolicy::MANUAL), fragmentation_threshold_(0.5),
+      compaction_stats_{0, 0, 0, 0}, last_compaction_{{}, 0}, realloc_stats_{0, 0, 0},
+      free_bins_(kNumBins), bin_bitmap_{}
 {
+    // An empty memory has no blocks at all
+    rover_ = kNil;
+    if (total_size_ == 0) {
+        return;
+    }
+
     MemoryBlock initial;
     initial.start = 0;
     initial.size = total_size_;
     initial.free = true;
-    initial.id = -1;
+    initial.id = kInvalidHandle;
+
+    head_ = new_record(initial);
+    rover_ = head_;
+    index_free(head_);
+}
+
+
+PhysicalMemory::BlockRef PhysicalMemory::new_record(const MemoryBlock& block)
+{
+    BlockRef ref;
+    if (!free_records_.empty()) {
+        ref = free_records_.back();
+        free_records_.pop_back();
+    } else {
+        ref = static_cast<BlockRef>(records_.size());
+        records_.emplace_back();
+    }
+
+    records_[ref].block = block;
+    records_[ref].prev = kNil;
+    records_[ref].next = kNil;
+    return ref;
+}
+
+void PhysicalMemory::insert_before(BlockRef pos, BlockRef ref)
+{
+    BlockRef prev = records_[pos].prev;
+    records_[ref].prev = prev;
+    records_[ref].next = pos;
+    records_[pos].prev = ref;
+    if (prev == kNil) {
+        head_ = ref;
+    } else {
+        records_[prev].next = ref;
+    }
+}
+
+// Unlinks the record and returns it to the pool
+void PhysicalMemory::unlink(BlockRef ref)
+{
+    BlockRef prev = records_[ref].prev;
+    BlockRef next = records_[ref].next;
+    if (prev == kNil) {
+        head_ = next;
+    } else {
+        records_[prev].next = next;
+    }
+    if (next != kNil) {
+        records_[next].prev = prev;
+    }
+    free_records_.push_back(ref);
+}
+
+
+std::size_t PhysicalMemory::size_class(std::size_t size)
+{
+    if (size < kExactBins) {
+        return size;
+    }
+    // kExactBins is 2^6, so the first power-of-two bin starts at 64 bytes
+    return kExactBins + floor_log2(size) - 6;
+}
+
+void PhysicalMemory::index_free(BlockRef ref)
+{
+    const MemoryBlock& b = block(ref);
+    std::size_t bin = size_class(b.size);
+    free_bins_[bin].emplace(b.start, ref);
+    bin_bitmap_[bin / 64] |= 1ULL << (bin % 64);
+    free_by_size_.emplace(std::make_pair(b.size, b.start), ref);
+}
+
+void PhysicalMemory::unindex_free(BlockRef ref)
+{
+    const MemoryBlock& b = block(ref);
+    std::size_t bin = size_class(b.size);
+    free_bins_[bin].erase(b.start);
+    if (free_bins_[bin].empty()) {
+        bin_bitmap_[bin / 64] &= ~(1ULL << (bin % 64));
+    }
+    free_by_size_.erase(std::make_pair(b.size, b.start));
+}
+
+// Returns kNumBins if no bin at or above `from` holds a free block
+std::size_t PhysicalMemory::next_nonempty_bin(std::size_t from) const
+{
+    std::size_t word = from / 64;
+    if (word >= kBitmapWords) {
+        return kNumBins;
+    }
 
-    blocks_.push_back(initial);
+    std::uint64_t bits = bin_bitmap_[word] & (~0ULL << (from % 64));
+    while (bits == 0) {
+        if (++word == kBitmapWords) {
+            return kNumBins;
+        }
+        bits = bin_bitmap_[word];
+    }
+    return word * 64 + count_trailing_zeros(bits);
 }
 
 
 void PhysicalMemory::dump() const
 {
-    for (const auto& block : blocks_) {
+    for_each_block([](const MemoryBlock& block) {
         std::cout << "[0x" << std::hex << std::setw(4) << std::setfill('0')
                   << block.start << " - 0x" << std::setw(4) << std::setfill('0')
                   << (block.start + block.size - 1) << std::dec << "] ";
@@ -29,111 +139,509 @@ void PhysicalMemory::dump() const
         }
 
         std::cout << std::endl;
+    });
+}
+
+
+
+void PhysicalMemory::free_block(BlockHandle id)
+{
+    if (release_block(id) && compaction_policy_ == CompactionPolicy::BACKGROUND &&
+        external_fragmentation() > fragmentation_threshold_) {
+        compact();
     }
 }
 
+void PhysicalMemory::free_batch(const BlockHandle* ids, std::size_t count)
+{
+    bool released = false;
+    for (std::size_t i = 0; i < count; ++i) {
+        released = release_block(ids[i]) || released;
+    }
 
+    if (released && compaction_policy_ == CompactionPolicy::BACKGROUND &&
+        external_fragmentation() > fragmentation_threshold_) {
+        compact();
+    }
+}
 
-void PhysicalMemory::free_block(int id)
+// Returns the block to the free list, merging with free neighbours;
+// false if the id is not allocated
+bool PhysicalMemory::release_block(BlockHandle id)
 {
-    for (auto it = blocks_.begin(); it != blocks_.end(); ++it) {
-        if (!it->free && it->id == id) {
+    const BlockRef* found = live_blocks_.find(id);
+    if (found == nullptr) {
+        return false;
+    }
+
+    BlockRef ref = *found;
+    live_blocks_.erase(id);
+    used_bytes_ -= block(ref).size;
+
+    block(ref).free = true;
+    block(ref).id = kInvalidHandle;
+    block(ref).alignment = 1;
 
-            it->free = true;
-            it->id = -1;
+    // Merge with previous block if free
+    BlockRef prev = records_[ref].prev;
+    if (prev != kNil && block(prev).free) {
+        unindex_free(prev);
+        if (rover_ == ref) {
+            rover_ = prev;
+        }
+        block(prev).size += block(ref).size;
+        unlink(ref);
+        ref = prev;
+    }
+
+    // Merge with next block if free
+    BlockRef next = records_[ref].next;
+    if (next != kNil && block(next).free) {
+        unindex_free(next);
+        if (rover_ == next) {
+            rover_ = ref;
+        }
+        block(ref).size += block(next).size;
+        unlink(next);
+    }
+
+    index_free(ref);
+    return true;
+}
+
+
+bool PhysicalMemory::reallocate(BlockHandle id, std::size_t new_size)
+{
+    const BlockRef* found = live_blocks_.find(id);
+    if (found == nullptr || new_size == 0) {
+        return false;
+    }
 
-            // Merge with previous block if free
-            if (it != blocks_.begin()) {
-                auto prev = std::prev(it);
-                if (prev->free) {
-                    prev->size += it->size;
-                    it = blocks_.erase(it);
-                    it = prev;
+    BlockRef ref = *found;
+    std::size_t old_size = block(ref).size;
+    BlockRef next = records_[ref].next;
+
+    if (new_size <= old_size) {
+        // Shrink: the tail becomes free, merged with a free right neighbour
+        std::size_t tail = old_size - new_size;
+        if (tail > 0) {
+            block(ref).size = new_size;
+            used_bytes_ -= tail;
+            if (next != kNil && block(next).free) {
+                unindex_free(next);
+                block(next).start -= tail;
+                block(next).size += tail;
+                index_free(next);
+            } else {
+                MemoryBlock rest;
+                rest.start = block(ref).start + new_size;
+                rest.size = tail;
+                rest.free = true;
+                rest.id = kInvalidHandle;
+                BlockRef rest_ref = new_record(rest);
+                if (next == kNil) {
+                    records_[rest_ref].prev = ref;
+                    records_[ref].next = rest_ref;
+                } else {
+                    insert_before(next, rest_ref);
                 }
+                index_free(rest_ref);
             }
+        }
+        ++realloc_stats_.in_place;
+        return true;
+    }
 
-            // Merge with next block if free
-            auto next = std::next(it);
-            if (next != blocks_.end() && next->free) {
-                it->size += next->size;
-                blocks_.erase(next);
+    std::size_t extra = new_size - old_size;
+    if (next != kNil && block(next).free && block(next).size >= extra) {
+        // Grow into the free right neighbour
+        unindex_free(next);
+        block(ref).size = new_size;
+        used_bytes_ += extra;
+        if (block(next).size == extra) {
+            if (rover_ == next) {
+                rover_ = ref;
             }
+            unlink(next);
+        } else {
+            block(next).start += extra;
+            block(next).size -= extra;
+            index_free(next);
+        }
+        ++realloc_stats_.in_place;
+        return true;
+    }
 
-            return;
+    // Move: place a new block, then swap records so `id` owns it and the
+    // temporary handle owns (and frees) the old one
+    BlockHandle moved = allocate_aligned_with_strategy(new_size, block(ref).alignment);
+    if (moved == -1) {
+        ++realloc_stats_.failed;
+        return false;
+    }
+    BlockRef* new_ref = live_blocks_.find(moved);
+    std::swap(*new_ref, *live_blocks_.find(id));
+    block(*live_blocks_.find(id)).id = id;
+    block(*new_ref).id = moved;
+    free_block(moved);
+
+    ++realloc_stats_.moved;
+    return true;
+}
+
+const ReallocStats& PhysicalMemory::realloc_stats() const
+{
+    return realloc_stats_;
+}
+
+
+CompactionResult PhysicalMemory::compact()
+{
+    CompactionResult result{{}, 0};
+
+    // Drop every free block and slide each used block down to `next_start`
+    std::size_t next_start = 0;
+    BlockRef tail = kNil;
+    BlockRef ref = head_;
+    while (ref != kNil) {
+        BlockRef next = records_[ref].next;
+        if (block(ref).free) {
+            unindex_free(ref);
+            unlink(ref);
+        } else {
+            // Aligned blocks only slide to their next aligned address; the
+            // gap stays free. new_record may grow records_, so block(ref)
+            // is looked up again after it.
+            std::size_t dest = align_up(next_start, block(ref).alignment);
+            if (dest != next_start) {
+                MemoryBlock gap;
+                gap.start = next_start;
+                gap.size = dest - next_start;
+                gap.free = true;
+                gap.id = kInvalidHandle;
+                BlockRef gap_ref = new_record(gap);
+                insert_before(ref, gap_ref);
+                index_free(gap_ref);
+            }
+            MemoryBlock& b = block(ref);
+            if (b.start != dest) {
+                result.relocations.emplace(b.start, dest);
+                result.bytes_moved += b.size;
+                b.start = dest;
+            }
+            next_start = dest + b.size;
+            tail = ref;
+        }
+        ref = next;
+    }
+
+    // The remaining free space becomes one block at the top
+    rover_ = head_;
+    if (next_start < total_size_) {
+        MemoryBlock hole;
+        hole.start = next_start;
+        hole.size = total_size_ - next_start;
+        hole.free = true;
+        hole.id = kInvalidHandle;
+
+        BlockRef free_ref = new_record(hole);
+        records_[free_ref].prev = tail;
+        if (tail == kNil) {
+            head_ = free_ref;
+        } else {
+            records_[tail].next = free_ref;
         }
+        index_free(free_ref);
+        rover_ = free_ref;
     }
+
+    ++compaction_stats_.passes;
+    compaction_stats_.blocks_moved += result.relocations.size();
+    compaction_stats_.bytes_moved += result.bytes_moved;
+    last_compaction_ = result;
+    return result;
 }
 
+void PhysicalMemory::set_compaction_policy(CompactionPolicy policy, double fragmentation_threshold)
+{
+    compaction_policy_ = policy;
+    fragmentation_threshold_ = fragmentation_threshold;
+}
 
-int PhysicalMemory::allocate_from_block(std::list<MemoryBlock>::iterator it, std::size_t size)
+CompactionPolicy PhysicalMemory::compaction_policy() const
 {
-    int allocated_id = next_id_++;
+    return compaction_policy_;
+}
+
+const CompactionStats& PhysicalMemory::compaction_stats() const
+{
+    return compaction_stats_;
+}
+
+const CompactionResult& PhysicalMemory::last_compaction() const
+{
+    return last_compaction_;
+}
 
-    if (it->size == size) {
-        it->free = false;
-        it->id = allocated_id;
+
+BlockHandle PhysicalMemory::allocate_from_block(BlockRef ref, std::size_t size)
+{
+    unindex_free(ref);
+    used_bytes_ += size;
+
+    BlockHandle allocated_id;
+    if (block(ref).size == size) {
+        allocated_id = live_blocks_.insert(ref);
+        block(ref).free = false;
+        block(ref).id = allocated_id;
+        block(ref).alignment = 1;
     } else {
         MemoryBlock allocated;
-        allocated.start = it->start;
+        allocated.start = block(ref).start;
         allocated.size = size;
         allocated.free = false;
-        allocated.id = allocated_id;
 
-        it->start += size;
-        it->size -= size;
+        block(ref).start += size;
+        block(ref).size -= size;
 
-        blocks_.insert(it, allocated);
+        BlockRef used = new_record(allocated);
+        insert_before(ref, used);
+        allocated_id = live_blocks_.insert(used);
+        block(used).id = allocated_id;
+        index_free(ref);
     }
 
     return allocated_id;
 }
 
 
-int PhysicalMemory::allocate_first_fit(std::size_t size)
+// Hands out `count` blocks of `size` from the front of one free block,
+// which must hold them all; the hole is unindexed and reindexed once
+void PhysicalMemory::carve_blocks(BlockRef ref, std::size_t size, std::size_t count,
+                                  BlockHandle* out)
 {
-    for (auto it = blocks_.begin(); it != blocks_.end(); ++it) {
-        if (it->free && it->size >= size) {
-            return allocate_from_block(it, size);
+    unindex_free(ref);
+    used_bytes_ += size * count;
+
+    for (std::size_t i = 0; i < count; ++i) {
+        if (block(ref).size == size) {
+            // Only the last block can use up the hole; it takes the record
+            out[i] = live_blocks_.insert(ref);
+            block(ref).free = false;
+            block(ref).id = out[i];
+            block(ref).alignment = 1;
+            return;
         }
+
+        MemoryBlock allocated;
+        allocated.start = block(ref).start;
+        allocated.size = size;
+        allocated.free = false;
+
+        block(ref).start += size;
+        block(ref).size -= size;
+
+        BlockRef used = new_record(allocated);
+        insert_before(ref, used);
+        out[i] = live_blocks_.insert(used);
+        block(used).id = out[i];
     }
-    return -1;
+
+    index_free(ref);
 }
 
 
-int PhysicalMemory::allocate_best_fit(std::size_t size)
+// Splits the padding in front of the first aligned address off as its own
+// free block, then allocates from the rest
+BlockHandle PhysicalMemory::allocate_from_block_aligned(BlockRef ref, std::size_t size,
+                                                        std::size_t alignment)
 {
-    auto best = blocks_.end();
+    std::size_t padding = align_up(block(ref).start, alignment) - block(ref).start;
+    if (padding > 0) {
+        unindex_free(ref);
+
+        MemoryBlock pad;
+        pad.start = block(ref).start;
+        pad.size = padding;
+        pad.free = true;
+        pad.id = kInvalidHandle;
+        BlockRef pad_ref = new_record(pad);
+        insert_before(ref, pad_ref);
+        index_free(pad_ref);
+
+        block(ref).start += padding;
+        block(ref).size -= padding;
+        index_free(ref);
+    }
 
-    for (auto it = blocks_.begin(); it != blocks_.end(); ++it) {
-        if (it->free && it->size >= size) {
-            if (best == blocks_.end() || it->size < best->size) {
-                best = it;
-            }
+    BlockHandle id = allocate_from_block(ref, size);
+    records_[*live_blocks_.find(id)].block.alignment = alignment;
+    return id;
+}
+
+bool PhysicalMemory::fits_aligned(BlockRef ref, std::size_t size, std::size_t alignment) const
+{
+    const MemoryBlock& b = records_[ref].block;
+    std::size_t padding = align_up(b.start, alignment) - b.start;
+    return b.size >= padding && b.size - padding >= size;
+}
+
+
+// Lowest-addressed free block at or after from_addr that fits the request
+PhysicalMemory::BlockRef PhysicalMemory::find_first_fit(std::size_t size, std::size_t from_addr)
+{
+    std::size_t cls = size_class(size);
+    BlockRef first = kNil;
+
+    // Power-of-two bins may hold blocks smaller than the request
+    const auto& own = free_bins_[cls];
+    for (auto entry = own.lower_bound(from_addr); entry != own.end(); ++entry) {
+        if (block(entry->second).size >= size) {
+            first = entry->second;
+            break;
         }
     }
 
-    if (best != blocks_.end()) {
-        return allocate_from_block(best, size);
+    // Every block in a higher bin fits; the lowest address among them wins
+    for (std::size_t bin = next_nonempty_bin(cls + 1); bin < kNumBins;
+         bin = next_nonempty_bin(bin + 1)) {
+        auto entry = free_bins_[bin].lower_bound(from_addr);
+        if (entry == free_bins_[bin].end()) {
+            continue;
+        }
+        if (first == kNil || entry->first < block(first).start) {
+            first = entry->second;
+        }
     }
 
-    return -1;
+    return first;
 }
 
 
-int PhysicalMemory::allocate_worst_fit(std::size_t size)
+// A hole of size + alignment - 1 fits wherever it starts, so the indexed
+// search finds the first of those; smaller holes only fit if they start
+// near an aligned address, and are checked one by one
+PhysicalMemory::BlockRef PhysicalMemory::find_first_fit_aligned(std::size_t size,
+                                                                std::size_t alignment,
+                                                                std::size_t from_addr)
 {
-    auto worst = blocks_.end();
+    std::size_t always_fits = size + (alignment - 1);
+    BlockRef first = find_first_fit(always_fits, from_addr);
+
+    for (auto entry = free_by_size_.lower_bound(std::make_pair(size, std::size_t(0)));
+         entry != free_by_size_.end() && entry->first.first < always_fits; ++entry) {
+        std::size_t start = entry->first.second;
+        if (start >= from_addr && (first == kNil || start < block(first).start) &&
+            fits_aligned(entry->second, size, alignment)) {
+            first = entry->second;
+        }
+    }
+    return first;
+}
+
 
-    for (auto it = blocks_.begin(); it != blocks_.end(); ++it) {
-        if (it->free && it->size >= size) {
-            if (worst == blocks_.end() || it->size > worst->size) {
-                worst = it;
+// The free block the current strategy would allocate `size` from
+PhysicalMemory::BlockRef PhysicalMemory::find_hole(std::size_t size)
+{
+    switch (strategy_) {
+        case AllocationStrategy::BEST_FIT: {
+            auto best = free_by_size_.lower_bound(std::make_pair(size, std::size_t(0)));
+            return best == free_by_size_.end() ? kNil : best->second;
+        }
+        case AllocationStrategy::WORST_FIT: {
+            if (free_by_size_.empty() || free_by_size_.rbegin()->first.first < size) {
+                return kNil;
             }
+            std::size_t largest = free_by_size_.rbegin()->first.first;
+            return free_by_size_.lower_bound(std::make_pair(largest, std::size_t(0)))->second;
         }
+        case AllocationStrategy::NEXT_FIT: {
+            BlockRef next = find_first_fit(size, block(rover_).start);
+            return next == kNil ? find_first_fit(size, 0) : next;
+        }
+        case AllocationStrategy::FIRST_FIT:
+        default:
+            return find_first_fit(size, 0);
+    }
+}
+
+
+BlockHandle PhysicalMemory::allocate_first_fit(std::size_t size)
+{
+    if (size == 0 || size > total_size_) {
+        return -1;
+    }
+
+    BlockRef first = find_first_fit(size, 0);
+
+    if (first != kNil) {
+        return allocate_from_block(first, size);
+    }
+
+    return -1;
+}
+
+
+BlockHandle PhysicalMemory::allocate_next_fit(std::size_t size)
+{
+    if (size == 0 || size > total_size_) {
+        return -1;
+    }
+
+    // Search from the rover to the end, then wrap around to the front
+    BlockRef next = find_first_fit(size, block(rover_).start);
+    if (next == kNil) {
+        next = find_first_fit(size, 0);
+    }
+
+    if (next == kNil) {
+        return -1;
+    }
+
+    BlockHandle id = allocate_from_block(next, size);
+
+    // Resume after the new block: the split remainder or the next neighbour
+    rover_ = records_[*live_blocks_.find(id)].next;
+    if (rover_ == kNil) {
+        rover_ = head_;
+    }
+    return id;
+}
+
+
+BlockHandle PhysicalMemory::allocate_best_fit(std::size_t size)
+{
+    if (size == 0 || size > total_size_) {
+        return -1;
+    }
+
+    // Smallest hole that fits; equal sizes are ordered by address
+    auto best = free_by_size_.lower_bound(std::make_pair(size, std::size_t(0)));
+
+    if (best != free_by_size_.end()) {
+        return allocate_from_block(best->second, size);
+    }
+
+    return -1;
+}
+
+
+BlockHandle PhysicalMemory::allocate_worst_fit(std::size_t size)
+{
+    if (size == 0 || size > total_size_) {
+        return -1;
+    }
+
+    if (free_by_size_.empty()) {
+        return -1;
     }
 
-    if (worst != blocks_.end()) {
-        return allocate_from_block(worst, size);
+    // Lowest-addressed hole among those of the largest size
+    std::size_t largest = free_by_size_.rbegin()->first.first;
+    auto worst = free_by_size_.lower_bound(std::make_pair(largest, std::size_t(0)));
+
+    if (largest >= size) {
+        return allocate_from_block(worst->second, size);
     }
 
     return -1;
@@ -147,13 +655,7 @@ std::size_t PhysicalMemory::total_memory() const
 
 std::size_t PhysicalMemory::used_memory() const
 {
-    std::size_t used = 0;
-    for (const auto& block : blocks_) {
-        if (!block.free) {
-            used += block.size;
-        }
-    }
-    return used;
+    return used_bytes_;
 }
 
 std::size_t PhysicalMemory::free_memory() const
@@ -163,28 +665,253 @@ std::size_t PhysicalMemory::free_memory() const
 
 std::size_t PhysicalMemory::largest_free_block() const
 {
-    std::size_t largest = 0;
-    for (const auto& block : blocks_) {
-        if (block.free && block.size > largest) {
-            largest = block.size;
-        }
+    if (free_by_size_.empty()) {
+        return 0;
     }
-    return largest;
+    return free_by_size_.rbegin()->first.first;
 }
 
-double PhysicalMemory::external_fragmentation() const
+std::size_t PhysicalMemory::live_allocations() const
 {
-    std::size_t free_mem = free_memory();
-    if (free_mem == 0) {
-        return 0.0;
+    return live_blocks_.size();
+}
+
+std::size_t PhysicalMemory::block_start(BlockHandle id) const
+{
+    const BlockRef* found = live_blocks_.find(id);
+    if (found == nullptr) {
+        return static_cast<std::size_t>(-1);
     }
+    return records_[*found].block.start;
+}
+
+// One pass over the blocks plus a map lookup each: O(blocks log blocks)
+bool PhysicalMemory::check_invariants() const
+{
+    std::size_t expected_start = 0;
+    std::size_t used = 0;
+    std::size_t used_blocks = 0;
+    std::size_t free_blocks = 0;
+    bool prev_free = false;
+    bool rover_seen = rover_ == kNil;
+    BlockRef prev = kNil;
+
+    for (BlockRef ref = head_; ref != kNil; ref = records_[ref].next) {
+        const MemoryBlock& b = records_[ref].block;
+        if (records_[ref].prev != prev || b.start != expected_start || b.size == 0) {
+            return false;
+        }
 
-    std::size_t largest = largest_free_block();
-    return 1.0 - static_cast<double>(largest) / static_cast<double>(free_mem);
+        if (b.free) {
+            // Adjacent free blocks should have been merged
+            if (prev_free) {
+                return false;
+            }
+            auto by_size = free_by_size_.find({b.size, b.start});
+            const auto& bin = free_bins_[size_class(b.size)];
+            auto by_addr = bin.find(b.start);
+            if (by_size == free_by_size_.end() || by_size->second != ref ||
+                by_addr == bin.end() || by_addr->second != ref) {
+                return false;
+            }
+            ++free_blocks;
+        } else {
+            const BlockRef* live = live_blocks_.find(b.id);
+            if (live == nullptr || *live != ref) {
+                return false;
+            }
+            used += b.size;
+            ++used_blocks;
+        }
+
+        rover_seen = rover_seen || ref == rover_;
+        prev_free = b.free;
+        expected_start += b.size;
+        prev = ref;
+    }
+
+    // Bins and their bitmap agree with the blocks found
+    std::size_t binned = 0;
+    for (std::size_t bin = 0; bin < kNumBins; ++bin) {
+        bool marked = (bin_bitmap_[bin / 64] >> (bin % 64)) & 1;
+        if (marked == free_bins_[bin].empty()) {
+            return false;
+        }
+        binned += free_bins_[bin].size();
+    }
+
+    return expected_start == total_size_ && used == used_bytes_ &&
+           used_blocks == live_blocks_.size() && free_blocks == free_by_size_.size() &&
+           free_blocks == binned && rover_seen;
 }
 
 // IAllocator interface implementation
-int PhysicalMemory::allocate(std::size_t size)
+BlockHandle PhysicalMemory::allocate(std::size_t size)
+{
+    BlockHandle id = allocate_with_strategy(size);
+    if (id != -1 || compaction_policy_ == CompactionPolicy::MANUAL ||
+        size == 0 || size > free_memory()) {
+        return id;
+    }
+
+    // Enough free memory, just not in one piece: compact and retry
+    compact();
+    id = allocate_with_strategy(size);
+    if (id != -1) {
+        ++compaction_stats_.failures_avoided;
+    }
+    return id;
+}
+
+// Blocks of `size` that worst fit would place in a row in the largest
+// hole before the next-largest hole takes over
+std::size_t PhysicalMemory::worst_fit_run(BlockRef hole, std::size_t size) const
+{
+    const MemoryBlock& h = records_[hole].block;
+    auto next = free_by_size_.rbegin();
+    if (next->second == hole) {
+        ++next;
+    }
+    if (next == free_by_size_.rend()) {
+        return h.size / size;
+    }
+    std::size_t other = next->first.first;
+    if (other == h.size) {
+        return 1;
+    }
+
+    // Ties between equal holes go to the lower address
+    std::size_t keep = (h.size - other) / size;
+    std::size_t other_start = free_by_size_.lower_bound(std::make_pair(other, std::size_t(0)))->first.second;
+    if ((h.size - other) % size == 0 && h.start + keep * size > other_start) {
+        --keep;
+    }
+    return keep + 1;
+}
+
+std::size_t PhysicalMemory::allocate_batch(const std::size_t* sizes, std::size_t count,
+                                           BlockHandle* out)
+{
+    std::size_t allocated = 0;
+    std::size_t i = 0;
+    while (i < count) {
+        std::size_t size = sizes[i];
+        std::size_t run = 1;
+        while (i + run < count && sizes[i + run] == size) {
+            ++run;
+        }
+
+        std::size_t done = 0;
+        while (size > 0 && size <= total_size_ && done < run) {
+            BlockRef hole = find_hole(size);
+            if (hole == kNil) {
+                break;
+            }
+            std::size_t take = std::min(run - done, block(hole).size / size);
+            if (strategy_ == AllocationStrategy::WORST_FIT) {
+                take = std::min(take, worst_fit_run(hole, size));
+            }
+            carve_blocks(hole, size, take, out + i + done);
+            done += take;
+
+            if (strategy_ == AllocationStrategy::NEXT_FIT) {
+                rover_ = records_[*live_blocks_.find(out[i + done - 1])].next;
+                if (rover_ == kNil) {
+                    rover_ = head_;
+                }
+            }
+        }
+        allocated += done;
+
+        // Rejected sizes and requests that need compaction take the single path
+        for (; done < run; ++done) {
+            out[i + done] = allocate(size);
+            allocated += out[i + done] != -1 ? 1 : 0;
+        }
+        i += run;
+    }
+    return allocated;
+}
+
+BlockHandle PhysicalMemory::allocate_aligned(std::size_t size, std::size_t alignment)
+{
+    if (!is_power_of_two(alignment) || size == 0 || size > total_size_) {
+        return -1;
+    }
+
+    BlockHandle id = allocate_aligned_with_strategy(size, alignment);
+    if (id != -1 || compaction_policy_ == CompactionPolicy::MANUAL ||
+        size > free_memory()) {
+        return id;
+    }
+
+    compact();
+    id = allocate_aligned_with_strategy(size, alignment);
+    if (id != -1) {
+        ++compaction_stats_.failures_avoided;
+    }
+    return id;
+}
+
+BlockHandle PhysicalMemory::allocate_aligned_with_strategy(std::size_t size, std::size_t alignment)
+{
+    BlockRef chosen = kNil;
+
+    switch (strategy_) {
+        case AllocationStrategy::BEST_FIT:
+            // Smallest hole that fits once aligned
+            for (auto entry = free_by_size_.lower_bound(std::make_pair(size, std::size_t(0)));
+                 entry != free_by_size_.end(); ++entry) {
+                if (fits_aligned(entry->second, size, alignment)) {
+                    chosen = entry->second;
+                    break;
+                }
+            }
+            break;
+        case AllocationStrategy::WORST_FIT:
+            // Largest hole, lowest address first among equals
+            for (auto entry = free_by_size_.rbegin(); entry != free_by_size_.rend(); ) {
+                std::size_t hole = entry->first.first;
+                auto same = free_by_size_.lower_bound(std::make_pair(hole, std::size_t(0)));
+                for (auto it = same; it != free_by_size_.end() && it->first.first == hole; ++it) {
+                    if (fits_aligned(it->second, size, alignment)) {
+                        chosen = it->second;
+                        break;
+                    }
+                }
+                if (chosen != kNil || hole < size) {
+                    break;
+                }
+                entry = std::make_reverse_iterator(same);
+            }
+            break;
+        case AllocationStrategy::NEXT_FIT:
+            chosen = find_first_fit_aligned(size, alignment, block(rover_).start);
+            if (chosen == kNil) {
+                chosen = find_first_fit_aligned(size, alignment, 0);
+            }
+            break;
+        case AllocationStrategy::FIRST_FIT:
+        default:
+            chosen = find_first_fit_aligned(size, alignment, 0);
+            break;
+    }
+
+    if (chosen == kNil) {
+        return -1;
+    }
+
+    BlockHandle id = allocate_from_block_aligned(chosen, size, alignment);
+    if (strategy_ == AllocationStrategy::NEXT_FIT) {
+        rover_ = records_[*live_blocks_.find(id)].next;
+        if (rover_ == kNil) {
+            rover_ = head_;
+        }
+    }
+    return id;
+}
+
+BlockHandle PhysicalMemory::allocate_with_strategy(std::size_t size)
 {
     switch (strategy_) {
         case AllocationStrategy::FIRST_FIT:
@@ -193,6 +920,8 @@ int PhysicalMemory::allocate(std::size_t size)
             return allocate_best_fit(size);
         case AllocationStrategy::WORST_FIT:
             return allocate_worst_fit(size);
+        case AllocationStrategy::NEXT_FIT:
+            return allocate_next_fit(size);
         default:
             return allocate_first_fit(size);
     }
@@ -217,6 +946,8 @@ const char* PhysicalMemory::allocator_name() const
             return "Best Fit";
         case AllocationStrategy::WORST_FIT:
             return "Worst Fit";
+        case AllocationStrategy::NEXT_FIT:
+            return "Next Fit";
         default:
             return "First Fit";
     }
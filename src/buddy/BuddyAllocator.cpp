@@ -1,47 +1,173 @@
 #include "buddy/BuddyAllocator.h"
+#include "allocator/BitUtils.h"
 #include <iostream>
 #include <iomanip>
 #include <stdexcept>
 #include <algorithm>
-#include <unordered_set>
+#include <utility>
 
-bool BuddyAllocator::is_power_of_two(std::size_t x) {
-    return x != 0 && (x & (x - 1)) == 0;
+// Smallest k with 2^k >= x
+std::size_t BuddyAllocator::log2_exact(std::size_t x) {
+    return x <= 1 ? 0 : floor_log2(x - 1) + 1;
 }
 
-std::size_t BuddyAllocator::log2_exact(std::size_t x) {
-    std::size_t k = 0;
-    while ((static_cast<std::size_t>(1) << k) < x) {
-        ++k;
+BuddyAllocator::BuddyAllocator(std::size_t total_memory, CoalescingMode mode,
+                               std::size_t lazy_watermark)
+    : total_memory_(total_memory), nonempty_orders_{0, 0, 0},
+      allocated_bytes_(0), requested_bytes_(0),
+      mode_(mode), lazy_watermark_(lazy_watermark), deferred_blocks_(0),
+      stats_{0, 0, 0, 0, 0, 0}, realloc_stats_{0, 0, 0}, mobility_{0, 0, 0, 0},
+      window_attempts_(0), window_successes_(0) {
+
+    if (total_memory_ == 0) {
+        throw std::invalid_argument("BuddyAllocator requires non-zero total memory");
+    }
+
+    max_order_ = floor_log2(total_memory_);
+    for (std::vector<std::list<std::size_t>>& lists : free_lists_) {
+        lists.resize(max_order_ + 1);
+    }
+
+    // Every pageblock starts out MOVABLE
+    pageblock_order_ = std::min(kDefaultPageblockOrder, max_order_);
+    std::size_t pageblock_size = static_cast<std::size_t>(1) << pageblock_order_;
+    pageblock_types_.assign((total_memory_ + pageblock_size - 1) / pageblock_size,
+                            static_cast<std::uint8_t>(MigrateType::MOVABLE));
+
+    // Carve memory into maximal aligned power-of-two top-level blocks,
+    // largest first (48 -> 32 + 16). Each block starts at a sum of larger
+    // powers of two, so it is aligned to its own size.
+    std::size_t addr = 0;
+    while (addr < total_memory_) {
+        std::size_t order = floor_log2(total_memory_ - addr);
+        push_free(addr, order);
+        addr += static_cast<std::size_t>(1) << order;
+    }
+}
+
+// The block joins the lists of the type owning its first pageblock
+void BuddyAllocator::push_free(std::size_t addr, std::size_t order, bool deferred) {
+    std::uint8_t type = pageblock_types_[addr >> pageblock_order_];
+    std::list<std::size_t>& list = free_lists_[type][order];
+    list.push_front(addr);
+    free_index_[addr] = FreeEntry{order, list.begin(), deferred, type};
+    nonempty_orders_[type] |= 1ULL << order;
+    ++stats_.list_ops;
+    if (deferred) {
+        ++deferred_blocks_;
+    }
+}
+
+// Unlinks an indexed free block; returns whether it was deferred
+bool BuddyAllocator::forget_free(std::unordered_map<std::size_t, FreeEntry>::iterator it) {
+    std::size_t order = it->second.order;
+    bool deferred = it->second.deferred;
+    std::uint8_t type = it->second.type;
+    free_lists_[type][order].erase(it->second.pos);
+    free_index_.erase(it);
+    if (free_lists_[type][order].empty()) {
+        nonempty_orders_[type] &= ~(1ULL << order);
+    }
+    ++stats_.list_ops;
+    if (deferred) {
+        --deferred_blocks_;
+    }
+    return deferred;
+}
+
+// Removes the block at addr if it is free at exactly this order
+bool BuddyAllocator::take_free(std::size_t addr, std::size_t order) {
+    auto it = free_index_.find(addr);
+    if (it == free_index_.end() || it->second.order != order) {
+        return false;
+    }
+    forget_free(it);
+    return true;
+}
+
+// Moves a free block to the lists of its pageblock's current type
+void BuddyAllocator::relink_free(std::unordered_map<std::size_t, FreeEntry>::iterator it) {
+    std::size_t addr = it->first;
+    std::size_t order = it->second.order;
+    bool deferred = forget_free(it);
+    push_free(addr, order, deferred);
+}
+
+// Merges a block with free buddies as far as possible, then frees it
+void BuddyAllocator::merge_and_push(std::size_t addr, std::size_t order) {
+    while (order < max_order_) {
+        std::size_t block_size = static_cast<std::size_t>(1) << order;
+        std::size_t buddy_addr = addr ^ block_size;
+
+        // A top-level block has no buddy inside memory; never merge past the end
+        if (buddy_addr + block_size > total_memory_) {
+            break;
+        }
+        if (!take_free(buddy_addr, order)) {
+            break;
+        }
+
+        addr = std::min(addr, buddy_addr);
+        ++order;
+        ++stats_.merges;
     }
-    return k;
+
+    push_free(addr, order);
 }
 
-BuddyAllocator::BuddyAllocator(std::size_t total_memory)
-    : total_memory_(total_memory), next_id_(1) {
+std::size_t BuddyAllocator::coalesce() {
+    std::size_t merges_before = stats_.merges;
 
-    if (!is_power_of_two(total_memory_)) {
-        throw std::invalid_argument(
-            "BuddyAllocator requires total memory to be a power of two");
+    // Lowest orders first, so merged blocks can merge again further up
+    std::vector<std::pair<std::size_t, std::size_t>> deferred;
+    for (const auto& [addr, entry] : free_index_) {
+        if (entry.deferred) {
+            deferred.push_back({entry.order, addr});
+        }
     }
+    std::sort(deferred.begin(), deferred.end());
 
-    max_order_ = log2_exact(total_memory_);
-    free_lists_.resize(max_order_ + 1);
+    for (const auto& [order, addr] : deferred) {
+        // An earlier merge may already have absorbed this block
+        auto it = free_index_.find(addr);
+        if (it == free_index_.end() || it->second.order != order || !it->second.deferred) {
+            continue;
+        }
+        forget_free(it);
+        merge_and_push(addr, order);
+    }
 
-    // Entire memory starts as one free block
-    free_lists_[max_order_].push_back(0);
+    ++stats_.coalesce_passes;
+    return stats_.merges - merges_before;
+}
+
+CoalescingMode BuddyAllocator::coalescing_mode() const {
+    return mode_;
+}
+
+std::size_t BuddyAllocator::deferred_blocks() const {
+    return deferred_blocks_;
+}
+
+const BuddyAllocator::CoalescingStats& BuddyAllocator::coalescing_stats() const {
+    return stats_;
 }
 
 void BuddyAllocator::dump_free_lists() const {
+    static const char* const kTypeNames[kMigrateTypes] = {"Unmovable", "Movable", "Reclaimable"};
+
     std::cout << "Free Blocks by Order:\n";
     for (std::size_t order = 0; order <= max_order_; ++order) {
         std::size_t block_size = static_cast<std::size_t>(1) << order;
         
-        if (!free_lists_[order].empty()) {
+        for (std::size_t type = 0; type < kMigrateTypes; ++type) {
+            if (free_lists_[type][order].empty()) {
+                continue;
+            }
             std::cout << "Order " << order
-                      << " (size " << block_size << "): ";
+                      << " (size " << block_size << ", " << kTypeNames[type] << "): ";
 
-            for (std::size_t addr : free_lists_[order]) {
+            for (std::size_t addr : free_lists_[type][order]) {
                 std::cout << "0x" << std::hex << std::setw(4) << std::setfill('0') 
                           << addr << std::dec << " ";
             }
@@ -52,8 +178,8 @@ void BuddyAllocator::dump_free_lists() const {
     // Also show allocated blocks
     if (!allocated_blocks_.empty()) {
         std::cout << "\nAllocated Blocks:\n";
-        for (const auto& [addr, order] : allocated_blocks_) {
-            std::size_t size = static_cast<std::size_t>(1) << order;
+        for (const auto& [addr, block] : allocated_blocks_) {
+            std::size_t size = static_cast<std::size_t>(1) << block.order;
             std::cout << "[0x" << std::hex << std::setw(4) << std::setfill('0')
                       << addr << " - 0x" << std::setw(4) << std::setfill('0')
                       << (addr + size - 1) << std::dec << "] USED (size=" << size << ")\n";
@@ -62,59 +188,233 @@ void BuddyAllocator::dump_free_lists() const {
 }
 
 
-static std::size_t next_power_of_two(std::size_t x) {
-    if (x == 0) return 1;
-    --x;
-    x |= x >> 1;
-    x |= x >> 2;
-    x |= x >> 4;
-    x |= x >> 8;
-    x |= x >> 16;
-    if (sizeof(std::size_t) == 8) {
-        x |= x >> 32;
-    }
-    return x + 1;
+std::size_t BuddyAllocator::allocate_buddy(std::size_t size, MigrateType type) {
+    return allocate_buddy_aligned(size, 1, type);
 }
 
-
-std::size_t BuddyAllocator::allocate_buddy(std::size_t size) {
-    if (size == 0 || size > total_memory_) {
+// A block of order k starts at a multiple of 2^k, so alignments up to the
+// rounded size cost nothing. A larger alignment searches from its own
+// order and keeps the first piece of each split, which starts where the
+// larger block did.
+std::size_t BuddyAllocator::allocate_buddy_aligned(std::size_t size, std::size_t alignment,
+                                                   MigrateType type) {
+    if (size == 0 || size > total_memory_ || !is_power_of_two(alignment)) {
         return static_cast<std::size_t>(-1);
     }
 
-    std::size_t rounded_size = next_power_of_two(size);
-    std::size_t target_order = log2_exact(rounded_size);
+    std::size_t target_order = log2_exact(size);
+    std::size_t rounded_size = static_cast<std::size_t>(1) << target_order;
+    std::size_t search_order = std::max(target_order, static_cast<std::size_t>(floor_log2(alignment)));
 
-    if (target_order > max_order_) {
+    if (search_order > max_order_) {
         return static_cast<std::size_t>(-1);
     }
-
-    // Find the smallest order >= target_order with a free block
-    std::size_t current_order = target_order;
-    while (current_order <= max_order_ &&
-           free_lists_[current_order].empty()) {
-        ++current_order;
+    bool high_order = target_order >= pageblock_order_;
+
+    std::size_t addr;
+    std::size_t current_order;
+    bool found = find_free_block(search_order, type, addr, current_order);
+    if (!found && deferred_blocks_ > 0) {
+        // Under pressure: merge everything deferred and look again
+        coalesce();
+        found = find_free_block(search_order, type, addr, current_order);
     }
-
-    if (current_order > max_order_) {
+    if (!found) {
+        if (high_order) {
+            record_high_order(false);
+        }
         return static_cast<std::size_t>(-1);
     }
 
     // Take a block from the higher order
-    std::size_t addr = free_lists_[current_order].front();
-    free_lists_[current_order].pop_front();
+    bool was_deferred = forget_free(free_index_.find(addr));
+    if (was_deferred && current_order == target_order) {
+        ++stats_.deferred_reuses;
+    }
 
     // Split until we reach the target order
     while (current_order > target_order) {
         --current_order;
         std::size_t buddy_addr = addr + (static_cast<std::size_t>(1) << current_order);
-        free_lists_[current_order].push_front(buddy_addr);
+        push_free(buddy_addr, current_order);
+        ++stats_.splits;
     }
 
-    allocated_blocks_[addr] = target_order;
+    allocated_blocks_[addr] = AllocatedBlock{target_order, size, alignment, type};
+    allocated_bytes_ += rounded_size;
+    requested_bytes_ += size;
+    if (high_order) {
+        record_high_order(true);
+    }
     return addr;
 }
 
+std::uint64_t BuddyAllocator::all_nonempty_orders() const {
+    return nonempty_orders_[0] | nonempty_orders_[1] | nonempty_orders_[2];
+}
+
+// Picks a free block of at least `order` for `type`: the smallest one on the
+// type's own lists, otherwise the largest one of a fallback type (which is
+// stolen, see steal_block). The block stays on the free lists.
+bool BuddyAllocator::find_free_block(std::size_t order, MigrateType type,
+                                     std::size_t& addr, std::size_t& found_order) {
+    // Fallback order follows Linux: unmovable and reclaimable prefer each
+    // other and only then break up movable pageblocks
+    static const MigrateType kFallbacks[kMigrateTypes][kMigrateTypes - 1] = {
+        {MigrateType::RECLAIMABLE, MigrateType::MOVABLE},    // UNMOVABLE
+        {MigrateType::RECLAIMABLE, MigrateType::UNMOVABLE},  // MOVABLE
+        {MigrateType::UNMOVABLE, MigrateType::MOVABLE},      // RECLAIMABLE
+    };
+
+    std::size_t own = static_cast<std::size_t>(type);
+    std::uint64_t mask = ~0ULL << order;
+
+    // Smallest order >= order with a free block, in one bit scan
+    std::uint64_t candidates = nonempty_orders_[own] & mask;
+    if (candidates != 0) {
+        found_order = count_trailing_zeros(candidates);
+        addr = free_lists_[own][found_order].front();
+        return true;
+    }
+
+    for (MigrateType fallback : kFallbacks[own]) {
+        std::size_t other = static_cast<std::size_t>(fallback);
+        candidates = nonempty_orders_[other] & mask;
+        if (candidates == 0) {
+            continue;
+        }
+        // A whole free pageblock if there is one, taking the smallest so
+        // larger blocks stay intact; otherwise the largest partial block,
+        // so one steal covers as many future requests as possible
+        std::uint64_t whole = candidates & (~0ULL << pageblock_order_);
+        found_order = whole != 0 ? count_trailing_zeros(whole) : floor_log2(candidates);
+        addr = free_lists_[other][found_order].front();
+        ++mobility_.fallbacks;
+        found_order = steal_block(addr, found_order, order, type);
+        return true;
+    }
+    return false;
+}
+
+// A fallback took the free block at addr for a `type` request of
+// target_order. A block spanning whole pageblocks is first trimmed to what
+// the request needs, so the rest stays with its owner, and the pageblocks
+// kept change type. A smaller block claims its pageblock when it is large,
+// or when the request is not movable (so unmovable data does not end up
+// scattered over many pageblocks). Returns the block's order after trimming.
+std::size_t BuddyAllocator::steal_block(std::size_t addr, std::size_t order,
+                                        std::size_t target_order, MigrateType type) {
+    if (order < pageblock_order_) {
+        if (type != MigrateType::MOVABLE || order >= pageblock_order_ / 2) {
+            claim_pageblock(addr >> pageblock_order_, type);
+        }
+        return order;
+    }
+
+    bool deferred = forget_free(free_index_.find(addr));
+    std::size_t keep = std::max(target_order, pageblock_order_);
+    while (order > keep) {
+        --order;
+        push_free(addr + (static_cast<std::size_t>(1) << order), order);
+        ++stats_.splits;
+    }
+
+    std::size_t first = addr >> pageblock_order_;
+    std::size_t count = static_cast<std::size_t>(1) << (order - pageblock_order_);
+    for (std::size_t pb = first; pb < first + count; ++pb) {
+        pageblock_types_[pb] = static_cast<std::uint8_t>(type);
+    }
+    mobility_.pageblocks_claimed += count;
+    push_free(addr, order, deferred);
+    return order;
+}
+
+// Retypes a pageblock and moves its free blocks to the new type's lists.
+// Free and allocated blocks tile memory, so the walk visits block starts.
+void BuddyAllocator::claim_pageblock(std::size_t pageblock, MigrateType type) {
+    pageblock_types_[pageblock] = static_cast<std::uint8_t>(type);
+    ++mobility_.pageblocks_claimed;
+
+    std::size_t addr = pageblock << pageblock_order_;
+    std::size_t end = std::min(addr + (static_cast<std::size_t>(1) << pageblock_order_),
+                               total_memory_);
+    while (addr < end) {
+        std::size_t order;
+        auto free_it = free_index_.find(addr);
+        if (free_it != free_index_.end()) {
+            order = free_it->second.order;
+            relink_free(free_it);
+        } else {
+            auto used_it = allocated_blocks_.find(addr);
+            if (used_it == allocated_blocks_.end()) {
+                break;
+            }
+            order = used_it->second.order;
+        }
+        addr += static_cast<std::size_t>(1) << order;
+    }
+}
+
+void BuddyAllocator::record_high_order(bool success) {
+    ++mobility_.high_order_attempts;
+    ++window_attempts_;
+    if (success) {
+        ++mobility_.high_order_successes;
+        ++window_successes_;
+    }
+    if (window_attempts_ == kHighOrderWindow) {
+        high_order_history_.push_back(static_cast<double>(window_successes_) /
+                                      static_cast<double>(window_attempts_));
+        window_attempts_ = 0;
+        window_successes_ = 0;
+    }
+}
+
+bool BuddyAllocator::set_pageblock_order(std::size_t order) {
+    if (!allocated_blocks_.empty() || order > max_order_) {
+        return false;
+    }
+
+    std::vector<std::pair<std::size_t, FreeEntry>> blocks(free_index_.begin(), free_index_.end());
+    for (const auto& [addr, entry] : blocks) {
+        forget_free(free_index_.find(addr));
+    }
+
+    pageblock_order_ = order;
+    std::size_t pageblock_size = static_cast<std::size_t>(1) << pageblock_order_;
+    pageblock_types_.assign((total_memory_ + pageblock_size - 1) / pageblock_size,
+                            static_cast<std::uint8_t>(MigrateType::MOVABLE));
+
+    for (const auto& [addr, entry] : blocks) {
+        push_free(addr, entry.order, entry.deferred);
+    }
+    return true;
+}
+
+std::size_t BuddyAllocator::pageblock_order() const {
+    return pageblock_order_;
+}
+
+MigrateType BuddyAllocator::pageblock_type(std::size_t addr) const {
+    return static_cast<MigrateType>(pageblock_types_[addr >> pageblock_order_]);
+}
+
+const BuddyAllocator::MobilityStats& BuddyAllocator::mobility_stats() const {
+    return mobility_;
+}
+
+double BuddyAllocator::high_order_success_rate() const {
+    if (mobility_.high_order_attempts == 0) {
+        return 0.0;
+    }
+    return static_cast<double>(mobility_.high_order_successes) /
+           static_cast<double>(mobility_.high_order_attempts);
+}
+
+const std::vector<double>& BuddyAllocator::high_order_history() const {
+    return high_order_history_;
+}
+
 
 void BuddyAllocator::free_buddy(std::size_t addr) {
     auto it = allocated_blocks_.find(addr);
@@ -122,28 +422,78 @@ void BuddyAllocator::free_buddy(std::size_t addr) {
         return;
     }
 
-    std::size_t order = it->second;
+    std::size_t order = it->second.order;
+    allocated_bytes_ -= static_cast<std::size_t>(1) << order;
+    requested_bytes_ -= it->second.requested;
     allocated_blocks_.erase(it);
 
-    std::size_t current_addr = addr;
-    std::size_t current_order = order;
+    if (mode_ == CoalescingMode::LAZY && deferred_blocks_ < lazy_watermark_) {
+        // Hold the block at its order; a same-size request reuses it as is
+        push_free(addr, order, true);
+        ++stats_.deferred_frees;
+        return;
+    }
 
-    while (current_order < max_order_) {
-        std::size_t buddy_addr = current_addr ^ (static_cast<std::size_t>(1) << current_order);
+    merge_and_push(addr, order);
+}
 
-        auto& free_list = free_lists_[current_order];
-        auto buddy_it = std::find(free_list.begin(), free_list.end(), buddy_addr);
+std::size_t BuddyAllocator::reallocate_buddy(std::size_t addr, std::size_t new_size) {
+    auto it = allocated_blocks_.find(addr);
+    if (it == allocated_blocks_.end() || new_size == 0) {
+        return static_cast<std::size_t>(-1);
+    }
+    if (new_size > total_memory_) {
+        ++realloc_stats_.failed;
+        return static_cast<std::size_t>(-1);
+    }
 
-        if (buddy_it == free_list.end()) {
-            break;
+    std::size_t order = it->second.order;
+    std::size_t new_order = log2_exact(new_size);
+
+    // Growing in place needs the block to be the lower half at every level
+    // up to new_order, with each upper half free at exactly that order
+    bool fits = new_order <= order;
+    if (!fits && new_order <= max_order_ && addr % (static_cast<std::size_t>(1) << new_order) == 0) {
+        fits = true;
+        for (std::size_t o = order; o < new_order && fits; ++o) {
+            auto buddy = free_index_.find(addr + (static_cast<std::size_t>(1) << o));
+            fits = buddy != free_index_.end() && buddy->second.order == o;
         }
+    }
 
-        free_list.erase(buddy_it);
-        current_addr = std::min(current_addr, buddy_addr);
-        ++current_order;
+    if (fits) {
+        for (std::size_t o = order; o < new_order; ++o) {
+            take_free(addr + (static_cast<std::size_t>(1) << o), o);
+            ++stats_.merges;
+        }
+        // Shrinking frees upper halves; their buddies stay allocated, so
+        // there is nothing to merge with
+        for (std::size_t o = order; o > new_order; --o) {
+            push_free(addr + (static_cast<std::size_t>(1) << (o - 1)), o - 1);
+            ++stats_.splits;
+        }
+        allocated_bytes_ = allocated_bytes_ - (static_cast<std::size_t>(1) << order) +
+                           (static_cast<std::size_t>(1) << new_order);
+        requested_bytes_ = requested_bytes_ - it->second.requested + new_size;
+        it->second.order = new_order;
+        it->second.requested = new_size;
+        ++realloc_stats_.in_place;
+        return addr;
     }
 
-    free_lists_[current_order].push_front(current_addr);
+    // The new block keeps the alignment and mobility class asked for
+    std::size_t moved = allocate_buddy_aligned(new_size, it->second.alignment, it->second.type);
+    if (moved == static_cast<std::size_t>(-1)) {
+        ++realloc_stats_.failed;
+        return moved;
+    }
+    free_buddy(addr);
+    ++realloc_stats_.moved;
+    return moved;
+}
+
+const ReallocStats& BuddyAllocator::realloc_stats() const {
+    return realloc_stats_;
 }
 
 std::size_t BuddyAllocator::total_memory() const {
@@ -151,11 +501,7 @@ std::size_t BuddyAllocator::total_memory() const {
 }
 
 std::size_t BuddyAllocator::allocated_memory() const {
-    std::size_t sum = 0;
-    for (const auto& [addr, order] : allocated_blocks_) {
-        sum += static_cast<std::size_t>(1) << order;
-    }
-    return sum;
+    return allocated_bytes_;
 }
 
 std::size_t BuddyAllocator::free_memory() const {
@@ -163,95 +509,289 @@ std::size_t BuddyAllocator::free_memory() const {
 }
 
 std::size_t BuddyAllocator::largest_free_block() const {
-    for (std::size_t order = max_order_; order > 0; --order) {
-        if (!free_lists_[order].empty()) {
-            return static_cast<std::size_t>(1) << order;
-        }
+    std::uint64_t nonempty = all_nonempty_orders();
+    if (nonempty == 0) {
+        return 0;
     }
-    return free_lists_[0].empty() ? 0 : 1;
+    return static_cast<std::size_t>(1) << floor_log2(nonempty);
 }
 
 double BuddyAllocator::internal_fragmentation() const {
-    std::size_t allocated = allocated_memory();
-    if (allocated == 0) {
+    if (allocated_bytes_ == 0) {
         return 0.0;
     }
 
-    std::size_t requested = 0;
-    for (const auto& [addr, order] : allocated_blocks_) {
-        requested += static_cast<std::size_t>(1) << order;
-    }
-
-    return static_cast<double>(allocated - requested) /
-           static_cast<double>(allocated);
+    return static_cast<double>(allocated_bytes_ - requested_bytes_) /
+           static_cast<double>(allocated_bytes_);
 }
 
 
+// One hash lookup per free block
 bool BuddyAllocator::check_no_free_buddy_pairs() const {
-    for (std::size_t order = 0; order < max_order_; ++order) {
-        for (std::size_t addr : free_lists_[order]) {
-            std::size_t buddy =
-                addr ^ (static_cast<std::size_t>(1) << order);
-            for (std::size_t other : free_lists_[order]) {
-                if (other == buddy) {
-                    return false;
-                }
-            }
+    if (mode_ == CoalescingMode::LAZY) {
+        return true;
+    }
+    for (const auto& [addr, entry] : free_index_) {
+        std::size_t block_size = static_cast<std::size_t>(1) << entry.order;
+        std::size_t buddy = addr ^ block_size;
+        if (buddy + block_size > total_memory_) {
+            continue;
+        }
+        auto it = free_index_.find(buddy);
+        if (it != free_index_.end() && it->second.order == entry.order) {
+            return false;
         }
     }
     return true;
 }
 
+// Sorts free and allocated blocks by address and compares neighbours,
+// so the cost is O(blocks log blocks) whatever the block sizes
 bool BuddyAllocator::check_no_overlaps() const {
-    std::unordered_set<std::size_t> seen;
-    for (std::size_t order = 0; order <= max_order_; ++order) {
-        std::size_t size = static_cast<std::size_t>(1) << order;
-        for (std::size_t addr : free_lists_[order]) {
-            for (std::size_t i = 0; i < size; ++i) {
-                if (!seen.insert(addr + i).second) {
-                    return false;
-                }
-            }
+    std::vector<std::pair<std::size_t, std::size_t>> extents;
+    extents.reserve(free_index_.size() + allocated_blocks_.size());
+    for (const auto& [addr, entry] : free_index_) {
+        extents.push_back({addr, static_cast<std::size_t>(1) << entry.order});
+    }
+    for (const auto& [addr, block] : allocated_blocks_) {
+        extents.push_back({addr, static_cast<std::size_t>(1) << block.order});
+    }
+    std::sort(extents.begin(), extents.end());
+
+    std::size_t end = 0;
+    for (const auto& [addr, size] : extents) {
+        if (addr < end || addr % size != 0 || size > total_memory_ - addr) {
+            return false;
         }
+        end = addr + size;
     }
     return true;
 }
 
+bool BuddyAllocator::check_invariants() const {
+    if (!check_no_overlaps() || !check_no_free_buddy_pairs()) {
+        return false;
+    }
+
+    // Free and allocated blocks tile memory exactly
+    std::size_t free_bytes = 0;
+    std::size_t deferred = 0;
+    std::uint64_t nonempty[kMigrateTypes] = {0, 0, 0};
+    for (const auto& [addr, entry] : free_index_) {
+        free_bytes += static_cast<std::size_t>(1) << entry.order;
+        deferred += entry.deferred ? 1 : 0;
+        nonempty[entry.type] |= 1ULL << entry.order;
+        // Each free block is listed under its first pageblock's type
+        if (*entry.pos != addr || entry.type != pageblock_types_[addr >> pageblock_order_]) {
+            return false;
+        }
+    }
+    std::size_t allocated = 0;
+    std::size_t requested = 0;
+    for (const auto& [addr, block] : allocated_blocks_) {
+        allocated += static_cast<std::size_t>(1) << block.order;
+        requested += block.requested;
+    }
+    if (free_bytes + allocated != total_memory_ || allocated != allocated_bytes_ ||
+        requested != requested_bytes_) {
+        return false;
+    }
+
+    // Lists, index, order masks and deferred count agree
+    std::size_t listed = 0;
+    for (std::size_t type = 0; type < kMigrateTypes; ++type) {
+        for (const std::list<std::size_t>& list : free_lists_[type]) {
+            listed += list.size();
+        }
+        if (nonempty[type] != nonempty_orders_[type]) {
+            return false;
+        }
+    }
+    if (listed != free_index_.size() || deferred != deferred_blocks_) {
+        return false;
+    }
+
+    // Every handle maps to its own live block
+    std::vector<std::size_t> handle_addrs;
+    handle_addrs.reserve(handles_.size());
+    bool handles_live = true;
+    handles_.for_each([&](BlockHandle, std::size_t addr) {
+        handles_live = handles_live && allocated_blocks_.count(addr) != 0;
+        handle_addrs.push_back(addr);
+    });
+    std::sort(handle_addrs.begin(), handle_addrs.end());
+    return handles_live &&
+           std::adjacent_find(handle_addrs.begin(), handle_addrs.end()) == handle_addrs.end();
+}
+
 // IAllocator interface implementation
-int BuddyAllocator::allocate(std::size_t size) {
-    std::size_t addr = allocate_buddy(size);
+BlockHandle BuddyAllocator::allocate(std::size_t size) {
+    return allocate(size, MigrateType::MOVABLE);
+}
+
+BlockHandle BuddyAllocator::allocate(std::size_t size, MigrateType type) {
+    std::size_t addr = allocate_buddy(size, type);
     if (addr == static_cast<std::size_t>(-1)) {
         return -1;
     }
     
-    int id = next_id_++;
-    id_to_addr_[id] = addr;
-    addr_to_id_[addr] = id;
-    return id;
+    return handles_.insert(addr);
+}
+
+BlockHandle BuddyAllocator::allocate_aligned(std::size_t size, std::size_t alignment) {
+    std::size_t addr = allocate_buddy_aligned(size, alignment);
+    if (addr == static_cast<std::size_t>(-1)) {
+        return -1;
+    }
+
+    return handles_.insert(addr);
 }
 
-void BuddyAllocator::free_block(int id) {
-    auto it = id_to_addr_.find(id);
-    if (it == id_to_addr_.end()) {
+std::size_t BuddyAllocator::allocate_batch(const std::size_t* sizes, std::size_t count,
+                                           BlockHandle* out) {
+    std::size_t allocated = 0;
+    std::size_t i = 0;
+    while (i < count) {
+        std::size_t order = log2_exact(sizes[i]);
+        std::size_t run = 1;
+        while (sizes[i] > 0 && i + run < count && sizes[i + run] > 0 &&
+               log2_exact(sizes[i + run]) == order) {
+            ++run;
+        }
+
+        std::size_t done = 0;
+        if (run > 1 && order <= max_order_) {
+            done = allocate_run(sizes + i, run, order, out + i);
+        }
+        allocated += done;
+
+        // Whatever no shared block covered goes through the single path,
+        // which also coalesces deferred blocks and rejects bad sizes
+        for (; done < run; ++done) {
+            out[i + done] = allocate(sizes[i + done]);
+            allocated += out[i + done] != -1 ? 1 : 0;
+        }
+        i += run;
+    }
+    return allocated;
+}
+
+// Serves as much of a same-order run as it can and returns how many
+// requests it served. Free blocks of exactly the order go first, as single
+// calls would take them. The rest comes from shared blocks, each split
+// once down to its pieces; the unused tail goes back as the largest
+// aligned blocks that fit, so no two free buddies are left behind.
+std::size_t BuddyAllocator::allocate_run(const std::size_t* sizes, std::size_t count,
+                                         std::size_t order, BlockHandle* out) {
+    std::size_t piece = static_cast<std::size_t>(1) << order;
+    bool high_order = order >= pageblock_order_;
+    std::size_t served = 0;
+
+    auto hand_out = [&](std::size_t addr) {
+        std::size_t size = sizes[served];
+        allocated_blocks_[addr] = AllocatedBlock{order, size, 1, MigrateType::MOVABLE};
+        out[served] = handles_.insert(addr);
+        allocated_bytes_ += piece;
+        requested_bytes_ += size;
+        if (high_order) {
+            record_high_order(true);
+        }
+        ++served;
+    };
+
+    const std::list<std::size_t>& exact =
+        free_lists_[static_cast<std::size_t>(MigrateType::MOVABLE)][order];
+    while (served < count && !exact.empty()) {
+        std::size_t addr = exact.front();
+        if (forget_free(free_index_.find(addr))) {
+            ++stats_.deferred_reuses;
+        }
+        hand_out(addr);
+    }
+
+    while (served < count) {
+        std::size_t remaining = count - served;
+        std::size_t spread = std::min(log2_exact(remaining), max_order_ - order);
+        std::size_t addr;
+        std::size_t current_order;
+        while (spread > 0 &&
+               !find_free_block(order + spread, MigrateType::MOVABLE, addr, current_order)) {
+            --spread;
+        }
+        if (spread == 0) {
+            break;
+        }
+
+        std::size_t block_order = order + spread;
+        forget_free(free_index_.find(addr));
+        while (current_order > block_order) {
+            --current_order;
+            push_free(addr + (static_cast<std::size_t>(1) << current_order), current_order);
+            ++stats_.splits;
+        }
+
+        std::size_t take = std::min(remaining, static_cast<std::size_t>(1) << spread);
+        for (std::size_t k = 0; k < take; ++k) {
+            hand_out(addr + k * piece);
+        }
+
+        std::size_t pos = addr + take * piece;
+        std::size_t end = addr + (static_cast<std::size_t>(1) << block_order);
+        while (pos < end) {
+            std::size_t tail_order = std::min<std::size_t>(count_trailing_zeros(pos),
+                                                           floor_log2(end - pos));
+            push_free(pos, tail_order);
+            ++stats_.splits;
+            pos += static_cast<std::size_t>(1) << tail_order;
+        }
+    }
+    return served;
+}
+
+void BuddyAllocator::free_block(BlockHandle id) {
+    const std::size_t* addr = handles_.find(id);
+    if (addr == nullptr) {
         return;
     }
     
-    std::size_t addr = it->second;
-    id_to_addr_.erase(it);
-    addr_to_id_.erase(addr);
+    std::size_t block_addr = *addr;
+    handles_.erase(id);
     
-    free_buddy(addr);
+    free_buddy(block_addr);
+}
+
+bool BuddyAllocator::reallocate(BlockHandle id, std::size_t new_size) {
+    std::size_t* addr = handles_.find(id);
+    if (addr == nullptr) {
+        return false;
+    }
+
+    std::size_t new_addr = reallocate_buddy(*addr, new_size);
+    if (new_addr == static_cast<std::size_t>(-1)) {
+        return false;
+    }
+    *addr = new_addr;
+    return true;
+}
+
+std::size_t BuddyAllocator::block_start(BlockHandle id) const {
+    const std::size_t* addr = handles_.find(id);
+    return addr == nullptr ? static_cast<std::size_t>(-1) : *addr;
 }
 
 std::size_t BuddyAllocator::used_memory() const {
     return allocated_memory();
 }
 
+std::size_t BuddyAllocator::live_allocations() const {
+    return allocated_blocks_.size();
+}
+
 void BuddyAllocator::dump() const {
     dump_free_lists();
 }
 
 const char* BuddyAllocator::allocator_name() const {
-    return "Buddy System";
+    return mode_ == CoalescingMode::LAZY ? "Buddy (lazy)" : "Buddy System";
 }
 
@@ -0,0 +1,172 @@
+#include "buddy/PerCpuPageCache.h"
+#include <iostream>
+#include <iomanip>
+#include <stdexcept>
+
+double PerCpuPageCache::CpuStats::hit_rate() const {
+    std::size_t total = alloc_hits + alloc_misses;
+    if (total == 0) {
+        return 0.0;
+    }
+    return static_cast<double>(alloc_hits) / static_cast<double>(total);
+}
+
+PerCpuPageCache::PerCpuPageCache(BuddyAllocator& zone, const PageCacheConfig& config)
+    : zone_(zone), config_(config), cpus_(config.cpus) {
+
+    if (config_.cpus == 0) {
+        throw std::invalid_argument("PerCpuPageCache requires at least one CPU");
+    }
+    if (config_.page_size == 0 || (config_.page_size & (config_.page_size - 1)) != 0) {
+        throw std::invalid_argument("Page size must be a power of two");
+    }
+    if (config_.batch == 0 || config_.batch > config_.high) {
+        throw std::invalid_argument("Batch size must be between 1 and the high watermark");
+    }
+
+    for (CpuCache& cpu : cpus_) {
+        cpu.lists.resize(config_.max_cached_order + 1);
+    }
+}
+
+PerCpuPageCache::~PerCpuPageCache() {
+    drain_all();
+}
+
+std::size_t PerCpuPageCache::block_bytes(unsigned order) const {
+    return config_.page_size << order;
+}
+
+// Caller holds the CPU's lock; fresh frames go to the cold end
+bool PerCpuPageCache::refill(std::deque<std::size_t>& list, unsigned order) {
+    std::lock_guard<std::mutex> guard(zone_lock_);
+    for (std::size_t i = 0; i < config_.batch; ++i) {
+        std::size_t addr = zone_.allocate_buddy(block_bytes(order));
+        if (addr == static_cast<std::size_t>(-1)) {
+            break;
+        }
+        list.push_back(addr);
+    }
+    return !list.empty();
+}
+
+// Caller holds the CPU's lock; the coldest frames leave first
+void PerCpuPageCache::drain(std::deque<std::size_t>& list, std::size_t count) {
+    std::lock_guard<std::mutex> guard(zone_lock_);
+    for (std::size_t i = 0; i < count && !list.empty(); ++i) {
+        zone_.free_buddy(list.back());
+        list.pop_back();
+    }
+}
+
+
+std::size_t PerCpuPageCache::alloc_pages(unsigned cpu, unsigned order) {
+    if (cpu >= cpus_.size()) {
+        return static_cast<std::size_t>(-1);
+    }
+
+    if (order > config_.max_cached_order) {
+        std::lock_guard<std::mutex> guard(zone_lock_);
+        return zone_.allocate_buddy(block_bytes(order));
+    }
+
+    CpuCache& cache = cpus_[cpu];
+    std::lock_guard<std::mutex> guard(cache.lock);
+    std::deque<std::size_t>& list = cache.lists[order];
+
+    if (list.empty()) {
+        ++cache.alloc_misses;
+        if (!refill(list, order)) {
+            return static_cast<std::size_t>(-1);
+        }
+        ++cache.refills;
+    } else {
+        ++cache.alloc_hits;
+    }
+
+    std::size_t addr = list.front();
+    list.pop_front();
+    return addr;
+}
+
+void PerCpuPageCache::free_pages(unsigned cpu, std::size_t addr, unsigned order, bool cold) {
+    if (cpu >= cpus_.size() || addr % block_bytes(order) != 0) {
+        return;
+    }
+
+    if (order > config_.max_cached_order) {
+        std::lock_guard<std::mutex> guard(zone_lock_);
+        zone_.free_buddy(addr);
+        return;
+    }
+
+    CpuCache& cache = cpus_[cpu];
+    std::lock_guard<std::mutex> guard(cache.lock);
+    std::deque<std::size_t>& list = cache.lists[order];
+
+    if (cold) {
+        list.push_back(addr);
+    } else {
+        list.push_front(addr);
+    }
+    ++cache.frees;
+
+    if (list.size() > config_.high) {
+        drain(list, config_.batch);
+        ++cache.drains;
+    }
+}
+
+void PerCpuPageCache::drain_all() {
+    for (CpuCache& cache : cpus_) {
+        std::lock_guard<std::mutex> guard(cache.lock);
+        for (std::deque<std::size_t>& list : cache.lists) {
+            drain(list, list.size());
+        }
+    }
+}
+
+
+PerCpuPageCache::CpuStats PerCpuPageCache::cpu_stats(unsigned cpu) const {
+    CpuStats stats{0, 0, 0, 0, 0, 0};
+    if (cpu >= cpus_.size()) {
+        return stats;
+    }
+
+    const CpuCache& cache = cpus_[cpu];
+    std::lock_guard<std::mutex> guard(cache.lock);
+    stats.alloc_hits = cache.alloc_hits;
+    stats.alloc_misses = cache.alloc_misses;
+    stats.frees = cache.frees;
+    stats.refills = cache.refills;
+    stats.drains = cache.drains;
+    for (const std::deque<std::size_t>& list : cache.lists) {
+        stats.cached_frames += list.size();
+    }
+    return stats;
+}
+
+std::size_t PerCpuPageCache::cached_frames() const {
+    std::size_t total = 0;
+    for (unsigned cpu = 0; cpu < cpus_.size(); ++cpu) {
+        total += cpu_stats(cpu).cached_frames;
+    }
+    return total;
+}
+
+const PageCacheConfig& PerCpuPageCache::config() const {
+    return config_;
+}
+
+void PerCpuPageCache::dump_stats() const {
+    std::cout << "Per-CPU Page Caches (high " << config_.high
+              << ", batch " << config_.batch << "):\n";
+    for (unsigned cpu = 0; cpu < cpus_.size(); ++cpu) {
+        CpuStats s = cpu_stats(cpu);
+        std::cout << "  CPU " << cpu << ": hit rate "
+                  << std::fixed << std::setprecision(1) << s.hit_rate() * 100.0 << "%"
+                  << " (" << s.alloc_hits << " hits, " << s.alloc_misses << " misses), "
+                  << s.refills << " refills, " << s.drains << " drains, "
+                  << s.cached_frames << " frames cached\n";
+    }
+}
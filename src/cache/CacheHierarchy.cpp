@@ -200,29 +200,95 @@
 
 #include "cache/CacheHierarchy.h"
 
+#include <algorithm>
+
 CacheHierarchy::CacheHierarchy(DirectMappedCache l1,
                                DirectMappedCache l2)
     : l1_(std::move(l1)),
-      l2_(std::move(l2)) {}
+      l2_(std::move(l2)),
+      traffic_{0, 0, 0, 0, 0, 0} {}
+
+bool CacheHierarchy::access(std::uint64_t physical_address, AccessType type) {
+    return access_level(physical_address, type) != HitLevel::MEMORY;
+}
+
+std::size_t CacheHierarchy::access_batch(const std::uint64_t* addrs, std::size_t n,
+                                         HitLevel* out, AccessType type) {
+    const std::size_t block = DirectMappedCache::kBatchBlock;
+    std::size_t hits = 0;
+    if (n > 0) {
+        l1_.prefetch_sets(addrs, std::min(block, n));
+        l2_.prefetch_sets(addrs, std::min(block, n));
+    }
+    for (std::size_t base = 0; base < n; base += block) {
+        std::size_t count = std::min(block, n - base);
+        if (base + block < n) {
+            l1_.prefetch_sets(addrs + base + block, std::min(block, n - base - block));
+            l2_.prefetch_sets(addrs + base + block, std::min(block, n - base - block));
+        }
+        for (std::size_t i = 0; i < count; ++i) {
+            out[base + i] = access_level(addrs[base + i], type);
+            hits += out[base + i] != HitLevel::MEMORY ? 1 : 0;
+        }
+    }
+    return hits;
+}
 
-bool CacheHierarchy::access(std::uint64_t physical_address) {
-    // Try L1
-    if (l1_.access(physical_address)) {
-        return true;
+HitLevel CacheHierarchy::access_level(std::uint64_t physical_address, AccessType type) {
+    // L1 installs the line itself unless a write miss skips allocation
+    AccessOutcome l1 = l1_.access_outcome(physical_address, type);
+    HitLevel level = l1.hit ? HitLevel::L1 : HitLevel::MEMORY;
+
+    if (!l1.hit) {
+        // L1 miss → L2 serves the fill, or takes the store itself
+        AccessType l2_type = type == AccessType::IFETCH ? AccessType::IFETCH : AccessType::READ;
+        if (!l1.allocated) {
+            l2_type = AccessType::WRITE;
+            traffic_.l1_to_l2_bytes += kStoreBytes;
+        } else {
+            traffic_.l2_to_l1_bytes += l1_.line_size();
+        }
+        AccessOutcome l2 = l2_.access_outcome(physical_address, l2_type);
+        account_l2(l2, kStoreBytes, true);
+        level = l2.hit ? HitLevel::L2 : HitLevel::MEMORY;
     }
 
-    // L1 miss → try L2
-    if (l2_.access(physical_address)) {
-        // L2 hit → fill L1 only
-        l1_.fill(physical_address);
-        return true;
+    if (l1.writeback) {
+        ++traffic_.l1_writebacks;
+        traffic_.l1_to_l2_bytes += l1_.line_size();
+        write_to_l2(l1.writeback_address, l1_.line_size());
+    }
+    if (l1.write_through && (l1.hit || l1.allocated)) {
+        traffic_.l1_to_l2_bytes += kStoreBytes;
+        write_to_l2(physical_address, kStoreBytes);
     }
 
-    // L2 miss → fetch from memory
-    l2_.fill(physical_address);
-    l1_.fill(physical_address);
+    return level;
+}
+
+// A writeback or written-through store reaching L2
+void CacheHierarchy::write_to_l2(std::uint64_t physical_address, std::size_t bytes) {
+    AccessOutcome l2 = l2_.absorb_write(physical_address);
+    // Allocating for a partial line needs the rest of it from memory
+    account_l2(l2, bytes, bytes < l2_.line_size());
+}
+
+void CacheHierarchy::account_l2(const AccessOutcome& outcome, std::size_t write_bytes,
+                                bool needs_fill) {
+    if (outcome.allocated && needs_fill) {
+        traffic_.memory_to_l2_bytes += l2_.line_size();
+    }
+    if (outcome.writeback) {
+        ++traffic_.l2_writebacks;
+        traffic_.l2_to_memory_bytes += l2_.line_size();
+    }
+    if (outcome.write_through) {
+        traffic_.l2_to_memory_bytes += write_bytes;
+    }
+}
 
-    return false;
+const CacheTraffic& CacheHierarchy::traffic() const {
+    return traffic_;
 }
 
 
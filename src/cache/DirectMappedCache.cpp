@@ -1,24 +1,104 @@
 #include "cache/DirectMappedCache.h"
+#include "allocator/BitUtils.h"
 
+#include <algorithm>
 #include <cmath>
 #include <stdexcept>
 
-static bool is_power_of_two(std::size_t x) {
-    return x != 0 && (x & (x - 1)) == 0;
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define CACHE_TAG_SIMD 1
+#include <immintrin.h>
+#endif
+
+#if CACHE_TAG_SIMD
+// Compiled for the extension only; called after the CPU check below
+
+__attribute__((target("avx2")))
+static std::uint64_t match_tags_avx2(const std::uint64_t* tags, std::size_t count,
+                                     std::uint64_t tag) {
+    const __m256i needle = _mm256_set1_epi64x(static_cast<long long>(tag));
+    std::uint64_t mask = 0;
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256i lanes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(tags + i));
+        __m256d equal = _mm256_castsi256_pd(_mm256_cmpeq_epi64(lanes, needle));
+        mask |= static_cast<std::uint64_t>(_mm256_movemask_pd(equal)) << i;
+    }
+    for (; i < count; ++i) {
+        mask |= static_cast<std::uint64_t>(tags[i] == tag) << i;
+    }
+    return mask;
+}
+
+__attribute__((target("sse4.1")))
+static std::uint64_t match_tags_sse41(const std::uint64_t* tags, std::size_t count,
+                                      std::uint64_t tag) {
+    const __m128i needle = _mm_set1_epi64x(static_cast<long long>(tag));
+    std::uint64_t mask = 0;
+    std::size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m128i lanes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(tags + i));
+        __m128d equal = _mm_castsi128_pd(_mm_cmpeq_epi64(lanes, needle));
+        mask |= static_cast<std::uint64_t>(_mm_movemask_pd(equal)) << i;
+    }
+    for (; i < count; ++i) {
+        mask |= static_cast<std::uint64_t>(tags[i] == tag) << i;
+    }
+    return mask;
+}
+#endif
+
+// Hint only; the simulated state never depends on it
+static inline void prefetch_host_line(const void* address) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(address);
+#else
+    (void)address;
+#endif
+}
+
+using TagMatchKernel = std::uint64_t (*)(const std::uint64_t*, std::size_t, std::uint64_t);
+
+// Best kernel the host supports, or null for the scalar loop
+static TagMatchKernel best_tag_matcher() {
+#if CACHE_TAG_SIMD
+    static const TagMatchKernel best = []() -> TagMatchKernel {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return match_tags_avx2;
+        }
+        if (__builtin_cpu_supports("sse4.1")) {
+            return match_tags_sse41;
+        }
+        return nullptr;
+    }();
+    return best;
+#else
+    return nullptr;
+#endif
 }
 
 DirectMappedCache::DirectMappedCache(std::size_t cache_size_bytes,
                                      std::size_t line_size_bytes,
-                                     std::size_t associativity)
+                                     std::size_t associativity,
+                                     ReplacementPolicy policy)
     : cache_size_(cache_size_bytes),
       line_size_(line_size_bytes),
       associativity_(associativity),
       num_sets_(0),
+      policy_(policy),
       offset_bits_(0),
       index_bits_(0),
+      write_policy_(WritePolicy::WRITE_BACK),
+      write_miss_policy_(WriteMissPolicy::WRITE_ALLOCATE),
       hits_(0),
       misses_(0),
-      timestamp_(0)
+      writebacks_(0),
+      write_throughs_(0),
+      valid_words_(0),
+      match_tags_(nullptr),
+      plru_words_(0),
+      rng_state_(0x9E3779B97F4A7C15ULL)
 {
     if (cache_size_ == 0 || line_size_ == 0 || associativity_ == 0) {
         throw std::invalid_argument("Cache size, line size, and associativity must be non-zero");
@@ -37,7 +117,47 @@ DirectMappedCache::DirectMappedCache(std::size_t cache_size_bytes,
     offset_bits_ = static_cast<std::size_t>(std::log2(line_size_));
     index_bits_  = static_cast<std::size_t>(std::log2(num_sets_));
 
-    sets_.resize(num_sets_, std::vector<CacheLine>(associativity_));
+    tags_.assign(num_sets_ * associativity_, 0);
+    valid_words_ = (associativity_ + 63) / 64;
+    valid_bits_.assign(num_sets_ * valid_words_, 0);
+    dirty_bits_.assign(num_sets_ * valid_words_, 0);
+    set_vectorized_lookup(associativity_ >= kVectorLookupWays);
+
+    switch (policy_) {
+        case ReplacementPolicy::FIFO:
+            fifo_next_.assign(num_sets_, 0);
+            break;
+        case ReplacementPolicy::LRU:
+            if (associativity_ > 65536) {
+                throw std::invalid_argument("LRU supports at most 65536 ways");
+            }
+            lru_rank_.resize(num_sets_ * associativity_);
+            for (std::size_t i = 0; i < lru_rank_.size(); ++i) {
+                lru_rank_[i] = static_cast<std::uint16_t>(i % associativity_);
+            }
+            break;
+        case ReplacementPolicy::TREE_PLRU:
+            if (!is_power_of_two(associativity_)) {
+                throw std::invalid_argument("Tree-PLRU needs a power-of-two associativity");
+            }
+            plru_words_ = std::max<std::size_t>(1, (associativity_ + 62) / 64);
+            plru_bits_.assign(num_sets_ * plru_words_, 0);
+            if (plru_words_ == 1) {
+                plru_path_mask_.assign(associativity_, 0);
+                plru_path_bits_.assign(associativity_, 0);
+                for (std::size_t way = 0; way < associativity_; ++way) {
+                    for (std::size_t node = way + associativity_; node > 1; node /= 2) {
+                        std::uint64_t bit = 1ULL << (node / 2 - 1);
+                        plru_path_mask_[way] |= bit;
+                        // Point the parent at the sibling subtree
+                        plru_path_bits_[way] |= (node & 1) ? 0 : bit;
+                    }
+                }
+            }
+            break;
+        case ReplacementPolicy::RANDOM:
+            break;
+    }
 }
 
 
@@ -45,6 +165,43 @@ std::size_t DirectMappedCache::num_sets() const {
     return num_sets_;
 }
 
+ReplacementPolicy DirectMappedCache::replacement_policy() const {
+    return policy_;
+}
+
+void DirectMappedCache::set_write_policy(WritePolicy policy, WriteMissPolicy miss_policy) {
+    write_policy_ = policy;
+    write_miss_policy_ = miss_policy;
+}
+
+WritePolicy DirectMappedCache::write_policy() const {
+    return write_policy_;
+}
+
+WriteMissPolicy DirectMappedCache::write_miss_policy() const {
+    return write_miss_policy_;
+}
+
+std::size_t DirectMappedCache::line_size() const {
+    return line_size_;
+}
+
+const char* DirectMappedCache::lookup_kernel() const {
+#if CACHE_TAG_SIMD
+    if (match_tags_ == match_tags_avx2) {
+        return "avx2";
+    }
+    if (match_tags_ == match_tags_sse41) {
+        return "sse4.1";
+    }
+#endif
+    return "scalar";
+}
+
+void DirectMappedCache::set_vectorized_lookup(bool enabled) {
+    match_tags_ = enabled ? best_tag_matcher() : nullptr;
+}
+
 CacheAddress DirectMappedCache::decode_address(std::uint64_t physical_address) const {
     CacheAddress addr;
 
@@ -59,42 +216,263 @@ CacheAddress DirectMappedCache::decode_address(std::uint64_t physical_address) c
 }
 
 
-bool DirectMappedCache::access(std::uint64_t physical_address) {
-    CacheAddress addr = decode_address(physical_address);
-    auto& set = sets_[addr.index];
+std::size_t DirectMappedCache::find_way(std::size_t set_index, std::uint64_t tag) const {
+    const std::uint64_t* tags = &tags_[set_index * associativity_];
+    const std::uint64_t* valid = &valid_bits_[set_index * valid_words_];
 
-    for (auto& line : set) {
-        if (line.valid && line.tag == addr.tag) {
-            ++hits_;
-            return true;
+    if (match_tags_ != nullptr) {
+        // Compare up to 64 ways at once, then keep the valid matches
+        for (std::size_t word = 0; word < valid_words_; ++word) {
+            std::size_t ways_in_word = std::min<std::size_t>(64, associativity_ - word * 64);
+            std::uint64_t hits = match_tags_(tags + word * 64, ways_in_word, tag) & valid[word];
+            if (hits != 0) {
+                return word * 64 + count_trailing_zeros(hits);
+            }
         }
+        return associativity_;
     }
 
-    ++misses_;
+    for (std::size_t way = 0; way < associativity_; ++way) {
+        if (tags[way] == tag && ((valid[way / 64] >> (way % 64)) & 1)) {
+            return way;
+        }
+    }
+    return associativity_;
+}
 
-    CacheLine* victim = nullptr;
 
-    for (auto& line : set) {
-        if (!line.valid) {
-            victim = &line;
-            break;
+std::size_t DirectMappedCache::choose_victim(std::size_t set_index) {
+    // Lowest invalid way, if any
+    const std::uint64_t* valid = &valid_bits_[set_index * valid_words_];
+    for (std::size_t word = 0; word < valid_words_; ++word) {
+        std::uint64_t invalid = ~valid[word];
+        std::size_t ways_in_word = std::min<std::size_t>(64, associativity_ - word * 64);
+        if (ways_in_word < 64) {
+            invalid &= (1ULL << ways_in_word) - 1;
         }
+        if (invalid != 0) {
+            return word * 64 + count_trailing_zeros(invalid);
+        }
+    }
+
+    switch (policy_) {
+        case ReplacementPolicy::LRU: {
+            const std::uint16_t* rank = &lru_rank_[set_index * associativity_];
+            for (std::size_t way = 0; way < associativity_; ++way) {
+                if (rank[way] == associativity_ - 1) {
+                    return way;
+                }
+            }
+            return 0;
+        }
+        case ReplacementPolicy::TREE_PLRU: {
+            // Follow the node bits from the root down to a leaf
+            const std::uint64_t* bits = &plru_bits_[set_index * plru_words_];
+            std::size_t node = 1;
+            while (node < associativity_) {
+                std::size_t bit = node - 1;
+                node = 2 * node + ((bits[bit / 64] >> (bit % 64)) & 1);
+            }
+            return node - associativity_;
+        }
+        case ReplacementPolicy::RANDOM:
+            // xorshift64
+            rng_state_ ^= rng_state_ << 13;
+            rng_state_ ^= rng_state_ >> 7;
+            rng_state_ ^= rng_state_ << 17;
+            return rng_state_ % associativity_;
+        case ReplacementPolicy::FIFO:
+        default:
+            return fifo_next_[set_index];
     }
+}
+
 
-    if (!victim) {
-        victim = &set[0];
-        for (auto& line : set) {
-            if (line.inserted_at < victim->inserted_at) {
-                victim = &line;
+// Records a use of the line for the recency-based policies
+void DirectMappedCache::touch(std::size_t set_index, std::size_t way) {
+    if (policy_ == ReplacementPolicy::LRU) {
+        std::uint16_t* rank = &lru_rank_[set_index * associativity_];
+        std::uint16_t used = rank[way];
+        for (std::size_t other = 0; other < associativity_; ++other) {
+            if (rank[other] < used) {
+                ++rank[other];
             }
         }
+        rank[way] = 0;
+    } else if (policy_ == ReplacementPolicy::TREE_PLRU) {
+        // Point every node on the way's path at the other subtree
+        std::uint64_t* bits = &plru_bits_[set_index * plru_words_];
+        if (plru_words_ == 1) {
+            bits[0] = (bits[0] & ~plru_path_mask_[way]) | plru_path_bits_[way];
+            return;
+        }
+        std::size_t node = way + associativity_;
+        while (node > 1) {
+            std::size_t went_right = node & 1;
+            node /= 2;
+            std::size_t bit = node - 1;
+            std::uint64_t mask = 1ULL << (bit % 64);
+            bits[bit / 64] = went_right ? bits[bit / 64] & ~mask : bits[bit / 64] | mask;
+        }
     }
+}
+
 
-    victim->valid = true;
-    victim->tag = addr.tag;
-    victim->inserted_at = timestamp_++;
+void DirectMappedCache::install(std::size_t set_index, std::size_t way, std::uint64_t tag) {
+    tags_[set_index * associativity_ + way] = tag;
+    valid_bits_[set_index * valid_words_ + way / 64] |= 1ULL << (way % 64);
+    dirty_bits_[set_index * valid_words_ + way / 64] &= ~(1ULL << (way % 64));
 
-    return false;
+    if (policy_ == ReplacementPolicy::FIFO) {
+        // Lines fill in way order, so the way after the newest is the oldest
+        fifo_next_[set_index] = static_cast<std::uint32_t>((way + 1) % associativity_);
+    }
+    touch(set_index, way);
+}
+
+
+// Reports the victim's writeback if it holds dirty data
+void DirectMappedCache::evict(std::size_t set_index, std::size_t way, AccessOutcome& outcome) {
+    std::uint64_t bit = 1ULL << (way % 64);
+    std::uint64_t& dirty = dirty_bits_[set_index * valid_words_ + way / 64];
+    if ((dirty & bit) == 0) {
+        return;
+    }
+
+    dirty &= ~bit;
+    ++writebacks_;
+    outcome.writeback = true;
+    std::uint64_t tag = tags_[set_index * associativity_ + way];
+    outcome.writeback_address = (tag << (offset_bits_ + index_bits_)) |
+                                (static_cast<std::uint64_t>(set_index) << offset_bits_);
+}
+
+
+AccessOutcome DirectMappedCache::lookup(std::uint64_t physical_address, AccessType type,
+                                        bool demand) {
+    CacheAddress addr = decode_address(physical_address);
+    return lookup_set(addr.index, addr.tag, type, demand);
+}
+
+
+AccessOutcome DirectMappedCache::lookup_set(std::size_t set_index, std::uint64_t tag,
+                                            AccessType type, bool demand) {
+    AccessOutcome outcome{false, false, false, false, 0};
+    bool write = type == AccessType::WRITE;
+
+    std::size_t way = find_way(set_index, tag);
+    if (way != associativity_) {
+        outcome.hit = true;
+        hits_ += demand ? 1 : 0;
+        touch(set_index, way);
+    } else {
+        misses_ += demand ? 1 : 0;
+        if (write && write_miss_policy_ == WriteMissPolicy::NO_WRITE_ALLOCATE) {
+            outcome.write_through = true;
+            ++write_throughs_;
+            return outcome;
+        }
+        way = choose_victim(set_index);
+        evict(set_index, way, outcome);
+        install(set_index, way, tag);
+        outcome.allocated = true;
+    }
+
+    if (write) {
+        if (write_policy_ == WritePolicy::WRITE_BACK) {
+            dirty_bits_[set_index * valid_words_ + way / 64] |= 1ULL << (way % 64);
+        } else {
+            outcome.write_through = true;
+            ++write_throughs_;
+        }
+    }
+    return outcome;
+}
+
+
+bool DirectMappedCache::access(std::uint64_t physical_address, AccessType type) {
+    return lookup(physical_address, type, true).hit;
+}
+
+AccessOutcome DirectMappedCache::access_outcome(std::uint64_t physical_address, AccessType type) {
+    return lookup(physical_address, type, true);
+}
+
+AccessOutcome DirectMappedCache::absorb_write(std::uint64_t physical_address) {
+    return lookup(physical_address, AccessType::WRITE, false);
+}
+
+
+std::size_t DirectMappedCache::access_batch(const std::uint64_t* addrs, std::size_t n,
+                                            HitLevel* out, AccessType type) {
+    // Two blocks of decoded addresses: one being looked up, the next one
+    // staged with its sets on their way into the host cache
+    std::size_t sets[2][kBatchBlock];
+    std::uint64_t tags[2][kBatchBlock];
+    const std::uint64_t index_mask = (1ULL << index_bits_) - 1;
+    const std::size_t tag_shift = offset_bits_ + index_bits_;
+
+    auto stage = [&](std::size_t base, std::size_t slot) {
+        std::size_t count = std::min(kBatchBlock, n - base);
+        for (std::size_t i = 0; i < count; ++i) {
+            sets[slot][i] = static_cast<std::size_t>((addrs[base + i] >> offset_bits_) & index_mask);
+            tags[slot][i] = addrs[base + i] >> tag_shift;
+        }
+        for (std::size_t i = 0; i < count; ++i) {
+            prefetch_set(sets[slot][i]);
+        }
+    };
+
+    std::size_t hits = 0;
+    std::size_t slot = 0;
+    if (n > 0) {
+        stage(0, slot);
+    }
+    for (std::size_t base = 0; base < n; base += kBatchBlock, slot ^= 1) {
+        if (base + kBatchBlock < n) {
+            stage(base + kBatchBlock, slot ^ 1);
+        }
+        std::size_t count = std::min(kBatchBlock, n - base);
+        for (std::size_t i = 0; i < count; ++i) {
+            bool hit = lookup_set(sets[slot][i], tags[slot][i], type, true).hit;
+            out[base + i] = hit ? HitLevel::L1 : HitLevel::MEMORY;
+            hits += hit ? 1 : 0;
+        }
+    }
+    return hits;
+}
+
+void DirectMappedCache::prefetch_sets(const std::uint64_t* addrs, std::size_t n) const {
+    const std::uint64_t index_mask = (1ULL << index_bits_) - 1;
+    for (std::size_t i = 0; i < n; ++i) {
+        prefetch_set(static_cast<std::size_t>((addrs[i] >> offset_bits_) & index_mask));
+    }
+}
+
+// Everything a lookup of the set reads: its tags, valid word and
+// replacement state. Wide sets only get their first tag lines; the
+// hardware prefetcher follows the rest of the run.
+void DirectMappedCache::prefetch_set(std::size_t set_index) const {
+    const std::uint64_t* tags = &tags_[set_index * associativity_];
+    std::size_t tag_lines = std::min<std::size_t>((associativity_ + 7) / 8, 2);
+    for (std::size_t line = 0; line < tag_lines; ++line) {
+        prefetch_host_line(tags + line * 8);
+    }
+    prefetch_host_line(&valid_bits_[set_index * valid_words_]);
+
+    switch (policy_) {
+        case ReplacementPolicy::FIFO:
+            prefetch_host_line(&fifo_next_[set_index]);
+            break;
+        case ReplacementPolicy::LRU:
+            prefetch_host_line(&lru_rank_[set_index * associativity_]);
+            break;
+        case ReplacementPolicy::TREE_PLRU:
+            prefetch_host_line(&plru_bits_[set_index * plru_words_]);
+            break;
+        case ReplacementPolicy::RANDOM:
+            break;
+    }
 }
 
 
@@ -106,6 +484,14 @@ std::size_t DirectMappedCache::misses() const {
     return misses_;
 }
 
+std::size_t DirectMappedCache::writebacks() const {
+    return writebacks_;
+}
+
+std::size_t DirectMappedCache::write_throughs() const {
+    return write_throughs_;
+}
+
 double DirectMappedCache::hit_ratio() const {
     std::size_t total = hits_ + misses_;
     if (total == 0) {
@@ -115,29 +501,20 @@ double DirectMappedCache::hit_ratio() const {
 }
 
 
-void DirectMappedCache::fill(std::uint64_t physical_address) {
+AccessOutcome DirectMappedCache::fill(std::uint64_t physical_address) {
     CacheAddress addr = decode_address(physical_address);
-    auto& set = sets_[addr.index];
+    AccessOutcome outcome{false, false, false, false, 0};
 
-    CacheLine* victim = nullptr;
-
-    for (auto& line : set) {
-        if (!line.valid) {
-            victim = &line;
-            break;
-        }
-    }
-
-    if (!victim) {
-        victim = &set[0];
-        for (auto& line : set) {
-            if (line.inserted_at < victim->inserted_at) {
-                victim = &line;
-            }
-        }
+    std::size_t way = find_way(addr.index, addr.tag);
+    if (way != associativity_) {
+        outcome.hit = true;
+        touch(addr.index, way);
+        return outcome;
     }
 
-    victim->valid = true;
-    victim->tag = addr.tag;
-    victim->inserted_at = timestamp_++;
+    way = choose_victim(addr.index);
+    evict(addr.index, way, outcome);
+    install(addr.index, way, addr.tag);
+    outcome.allocated = true;
+    return outcome;
 }
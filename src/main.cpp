@@ -1,6 +1,9 @@
 #include "allocator/IAllocator.h"
+#include "allocator/SlotMap.h"
 #include "allocator/PhysicalMemory.h"
 #include "buddy/BuddyAllocator.h"
+#include "tlsf/TlsfAllocator.h"
+#include "slab/SlabAllocator.h"
 #include "cache/CacheHierarchy.h"
 #include "cache/DirectMappedCache.h"
 #include "virtual_memory/VirtualMemoryManager.h"
@@ -9,12 +12,17 @@
 #include <string>
 #include <sstream>
 #include <iomanip>
-#include <map>
+#include <cstdint>
 
 class MemorySimulatorCLI {
 private:
     IAllocator* allocator;
-    std::map<int, size_t> blockSizes;  // Track sizes for display
+    // Block ids shown to the user -> allocator handle and requested size
+    struct CliBlock {
+        BlockHandle handle;
+        size_t size;
+    };
+    SlotMap<CliBlock> blocks;
     
     // Cache hierarchy components
     DirectMappedCache* l1Cache;
@@ -28,6 +36,10 @@ private:
     bool enableCache;
     bool enableVirtualMemory;
     size_t memorySize;
+
+    // Periodic invariant checking: every validateEvery malloc/free ops (0 = off)
+    size_t validateEvery;
+    size_t opsSinceValidate;
     
 public:
     MemorySimulatorCLI() 
@@ -38,7 +50,9 @@ public:
           vmManager(nullptr),
           enableCache(false),
           enableVirtualMemory(false),
-          memorySize(0) {}
+          memorySize(0),
+          validateEvery(0),
+          opsSinceValidate(0) {}
     
     ~MemorySimulatorCLI() {
         delete allocator;
@@ -142,7 +156,10 @@ private:
         std::cout << "  2. Best Fit\n";
         std::cout << "  3. Worst Fit\n";
         std::cout << "  4. Buddy System\n";
-        std::cout << "\nEnter choice (1-4): ";
+        std::cout << "  5. Next Fit\n";
+        std::cout << "  6. TLSF (Two-Level Segregated Fit)\n";
+        std::cout << "  7. Slab (object caches on Buddy System)\n";
+        std::cout << "\nEnter choice (1-7): ";
         
         int choice;
         if (!(std::cin >> choice)) {
@@ -181,6 +198,18 @@ private:
                     allocator = new BuddyAllocator(memorySize);
                     std::cout << "\nInitialized " << memorySize << " bytes with Buddy System allocator\n";
                     break;
+                case 5:
+                    allocator = new PhysicalMemory(memorySize, AllocationStrategy::NEXT_FIT);
+                    std::cout << "\nInitialized " << memorySize << " bytes with Next Fit allocator\n";
+                    break;
+                case 6:
+                    allocator = new TlsfAllocator(memorySize);
+                    std::cout << "\nInitialized " << memorySize << " bytes with TLSF allocator\n";
+                    break;
+                case 7:
+                    allocator = new SlabAllocator(memorySize);
+                    std::cout << "\nInitialized " << memorySize << " bytes with Slab allocator\n";
+                    break;
                 default:
                     std::cerr << "Invalid choice\n";
                     return false;
@@ -199,8 +228,10 @@ private:
      * 
      * @param virtualAddr The virtual address to access
      * @param description Description of the operation for logging
+     * @param type Read, write or instruction fetch, as seen by the caches
      */
-    void simulateMemoryAccess(uint64_t virtualAddr, const std::string& description) {
+    void simulateMemoryAccess(uint64_t virtualAddr, const std::string& description,
+                              AccessType type = AccessType::READ) {
         std::cout << "  [" << description << "]\n";
         
         uint64_t physicalAddr = virtualAddr;
@@ -228,20 +259,15 @@ private:
         
         // Step 2: Cache Access (if enabled)
         if (enableCache) {
-            size_t l1_hits_before = cacheHierarchy->l1_hits();
-            size_t l2_hits_before = cacheHierarchy->l2_hits();
-            
-            bool l1_hit = cacheHierarchy->access(physicalAddr);
-            
-            size_t l1_hits_after = cacheHierarchy->l1_hits();
-            size_t l2_hits_after = cacheHierarchy->l2_hits();
+            HitLevel level;
+            cacheHierarchy->access_batch(&physicalAddr, 1, &level, type);
             
             std::cout << "    " << (enableVirtualMemory ? "3" : "2") 
                       << ". Cache Access: ";
             
-            if (l1_hit) {
+            if (level == HitLevel::L1) {
                 std::cout << "L1 HIT\n";
-            } else if (l2_hits_after > l2_hits_before) {
+            } else if (level == HitLevel::L2) {
                 std::cout << "L1 MISS, L2 HIT\n";
             } else {
                 std::cout << "L1 MISS, L2 MISS --> Memory Access\n";
@@ -261,6 +287,8 @@ private:
             cmdMalloc(iss);
         } else if (cmd == "free") {
             cmdFree(iss);
+        } else if (cmd == "realloc") {
+            cmdRealloc(iss);
         } else if (cmd == "access") {
             cmdAccess(iss);
         } else if (cmd == "dump") {
@@ -271,6 +299,10 @@ private:
             cmdCacheStats();
         } else if (cmd == "vm_stats") {
             cmdVMStats();
+        } else if (cmd == "validate") {
+            cmdValidate(iss);
+        } else if (cmd == "compact") {
+            cmdCompact();
         } else if (cmd == "help") {
             cmdHelp();
         } else {
@@ -292,17 +324,18 @@ private:
             return;
         }
         
-        int blockId = allocator->allocate(size);
+        BlockHandle handle = allocator->allocate(size);
         
-        if (blockId != -1) {
-            blockSizes[blockId] = size;
+        if (handle != kInvalidHandle) {
+            BlockHandle blockId = blocks.insert(CliBlock{handle, size});
             std::cout << "Allocated block id=" << blockId << "\n";
+            validatePeriodically();
             
             // Simulate memory access through the integration layers
             if (enableVirtualMemory || enableCache) {
                 // Use block ID as a pseudo-address for demonstration
                 // Use smaller spacing (256 bytes) to work with small memory sizes
-                uint64_t addr = (blockId - 1) * 256;
+                uint64_t addr = static_cast<uint64_t>(handle_index(blockId)) * 256;
                 simulateMemoryAccess(addr, "Initial memory access after allocation");
             }
         } else {
@@ -314,8 +347,22 @@ private:
         uint64_t addr;
         
         if (!(iss >> std::hex >> addr)) {
-            std::cout << "Usage: access <address_in_hex>\n";
-            std::cout << "Example: access 0x1000\n";
+            std::cout << "Usage: access <address_in_hex> [r|w|x]\n";
+            std::cout << "Example: access 0x1000 w\n";
+            return;
+        }
+
+        std::string kind = "r";
+        iss >> kind;
+        AccessType type;
+        if (kind == "r") {
+            type = AccessType::READ;
+        } else if (kind == "w") {
+            type = AccessType::WRITE;
+        } else if (kind == "x") {
+            type = AccessType::IFETCH;
+        } else {
+            std::cout << "Error: access type must be r, w or x\n";
             return;
         }
         
@@ -324,26 +371,100 @@ private:
             return;
         }
         
-        simulateMemoryAccess(addr, "Manual memory access");
+        simulateMemoryAccess(addr, "Manual memory access", type);
     }
     
     void cmdFree(std::istringstream& iss) {
-        int blockId;
+        BlockHandle blockId;
         
         if (!(iss >> blockId)) {
             std::cout << "Usage: free <block_id>\n";
             return;
         }
         
-        auto it = blockSizes.find(blockId);
-        if (it == blockSizes.end()) {
+        const CliBlock* block = blocks.find(blockId);
+        if (block == nullptr) {
             std::cout << "Error: Block " << blockId << " not found\n";
             return;
         }
         
-        allocator->free_block(blockId);
-        blockSizes.erase(it);
+        allocator->free_block(block->handle);
+        blocks.erase(blockId);
         std::cout << "Block " << blockId << " freed and merged\n";
+        validatePeriodically();
+    }
+
+    void cmdRealloc(std::istringstream& iss) {
+        BlockHandle blockId;
+        size_t size;
+
+        if (!(iss >> blockId >> size) || size == 0) {
+            std::cout << "Usage: realloc <block_id> <new_size>\n";
+            return;
+        }
+
+        CliBlock* block = blocks.find(blockId);
+        if (block == nullptr) {
+            std::cout << "Error: Block " << blockId << " not found\n";
+            return;
+        }
+
+        std::size_t moved_before = allocator->realloc_stats().moved;
+        if (!allocator->reallocate(block->handle, size)) {
+            std::cout << "Error: Reallocation failed - not enough memory\n";
+            return;
+        }
+        block->size = size;
+        std::cout << "Block " << blockId << " resized to " << size << " bytes ("
+                  << (allocator->realloc_stats().moved > moved_before ? "moved" : "in place")
+                  << ")\n";
+        validatePeriodically();
+    }
+
+    void cmdValidate(std::istringstream& iss) {
+        size_t every;
+        if (iss >> every) {
+            validateEvery = every;
+            opsSinceValidate = 0;
+            if (every == 0) {
+                std::cout << "Periodic validation disabled\n";
+            } else {
+                std::cout << "Validating invariants every " << every << " operations\n";
+            }
+            return;
+        }
+
+        if (allocator->check_invariants()) {
+            std::cout << "Invariants OK (" << allocator->allocator_name() << ")\n";
+        } else {
+            std::cout << "Invariant check FAILED (" << allocator->allocator_name() << ")\n";
+        }
+    }
+
+    void cmdCompact() {
+        PhysicalMemory* memory = dynamic_cast<PhysicalMemory*>(allocator);
+        if (memory == nullptr) {
+            std::cout << "Compaction is only available for the first/best/worst/next fit allocators\n";
+            return;
+        }
+
+        CompactionResult result = memory->compact();
+        for (const auto& [from, to] : result.relocations) {
+            std::cout << "  moved 0x" << std::hex << from << " -> 0x" << to << std::dec << "\n";
+        }
+        std::cout << "Compacted: " << result.relocations.size() << " blocks, "
+                  << result.bytes_moved << " bytes moved; largest free block "
+                  << memory->largest_free_block() << " bytes\n";
+    }
+
+    void validatePeriodically() {
+        if (validateEvery == 0 || ++opsSinceValidate < validateEvery) {
+            return;
+        }
+        opsSinceValidate = 0;
+        if (!allocator->check_invariants()) {
+            std::cout << "Invariant check FAILED (" << allocator->allocator_name() << ")\n";
+        }
     }
     
     void cmdDump() {
@@ -351,13 +472,13 @@ private:
         allocator->dump();
         
         std::cout << "\n--- Allocated Blocks ---\n";
-        if (blockSizes.empty()) {
+        if (blocks.empty()) {
             std::cout << "No allocated blocks\n";
         } else {
-            for (const auto& entry : blockSizes) {
-                std::cout << "Block id=" << entry.first 
-                          << " size=" << entry.second << " bytes\n";
-            }
+            blocks.for_each([](BlockHandle id, const CliBlock& block) {
+                std::cout << "Block id=" << id 
+                          << " size=" << block.size << " bytes\n";
+            });
         }
         std::cout << "\n";
     }
@@ -375,8 +496,15 @@ private:
         std::cout << "Used memory: " << used << " (" 
                   << std::fixed << std::setprecision(2) << usagePercent << "%)\n";
         std::cout << "Free memory: " << free << "\n";
-        std::cout << "Active allocations: " << blockSizes.size() << "\n";
+        std::cout << "Active allocations: " << allocator->live_allocations() << "\n";
         std::cout << "Largest free block: " << allocator->largest_free_block() << "\n";
+        std::cout << "External fragmentation: " << std::fixed << std::setprecision(2)
+                  << allocator->external_fragmentation() * 100.0 << "%\n";
+        const ReallocStats& realloc = allocator->realloc_stats();
+        if (realloc.in_place + realloc.moved + realloc.failed > 0) {
+            std::cout << "Reallocations: " << realloc.in_place << " in place, "
+                      << realloc.moved << " moved, " << realloc.failed << " failed\n";
+        }
         std::cout << "\n";
     }
     
@@ -466,6 +594,16 @@ private:
             std::cout << "\nAverage Memory Access Time (AMAT): " 
                       << std::fixed << std::setprecision(2) << amat << " cycles\n";
         }
+
+        // Write traffic (write-back, write-allocate at both levels)
+        const CacheTraffic& traffic = cacheHierarchy->traffic();
+        std::cout << "\n--- Memory Traffic ---\n";
+        std::cout << "L1 Writebacks:     " << std::setw(8) << traffic.l1_writebacks << "\n";
+        std::cout << "L2 Writebacks:     " << std::setw(8) << traffic.l2_writebacks << "\n";
+        std::cout << "L2 -> L1:          " << std::setw(8) << traffic.l2_to_l1_bytes << " bytes\n";
+        std::cout << "L1 -> L2:          " << std::setw(8) << traffic.l1_to_l2_bytes << " bytes\n";
+        std::cout << "Memory -> L2:      " << std::setw(8) << traffic.memory_to_l2_bytes << " bytes\n";
+        std::cout << "L2 -> Memory:      " << std::setw(8) << traffic.l2_to_memory_bytes << " bytes\n";
         
         std::cout << "\n========================================\n\n";
     }
@@ -486,16 +624,19 @@ private:
         std::cout << "\n=== Available Commands ===\n\n";
         std::cout << "Allocation Operations:\n";
         std::cout << "  malloc <size>         - Allocate memory block\n";
-        std::cout << "  free <block_id>       - Free allocated block\n\n";
+        std::cout << "  free <block_id>       - Free allocated block\n";
+        std::cout << "  realloc <id> <size>   - Resize a block, in place when possible\n\n";
         
         std::cout << "Visualization:\n";
         std::cout << "  dump                  - Show memory layout\n";
-        std::cout << "  stats                 - Show statistics\n\n";
+        std::cout << "  stats                 - Show statistics\n";
+        std::cout << "  validate [N]          - Check invariants now, or every N ops (0 = off)\n";
+        std::cout << "  compact               - Slide used blocks together (fit allocators)\n\n";
         
         if (enableCache || enableVirtualMemory) {
             std::cout << "Memory Access & Integration:\n";
+            std::cout << "  access <addr> [r|w|x] - Read, write or fetch an address (translation & cache)\n";
             if (enableVirtualMemory) {
-                std::cout << "  access <vaddr>        - Access virtual address (translation & cache)\n";
                 std::cout << "  vm_stats              - Show virtual memory statistics\n";
             }
             if (enableCache) {
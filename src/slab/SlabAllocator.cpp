@@ -0,0 +1,404 @@
+#include "slab/SlabAllocator.h"
+#include "allocator/BitUtils.h"
+#include <iostream>
+#include <iomanip>
+#include <stdexcept>
+#include <algorithm>
+#include <utility>
+
+SlabAllocator::SlabAllocator(std::size_t total_memory, std::size_t slab_size)
+    : buddy_(total_memory), slab_size_(slab_size),
+      requested_bytes_(0), slot_bytes_(0), realloc_stats_{0, 0, 0} {
+
+    if (slab_size_ == 0 || (slab_size_ & (slab_size_ - 1)) != 0 ||
+        slab_size_ > total_memory) {
+        throw std::invalid_argument(
+            "SlabAllocator requires a power-of-two slab size no larger than memory");
+    }
+}
+
+std::size_t SlabAllocator::create_cache(std::size_t object_size) {
+    std::size_t rounded = (object_size + kObjectAlign - 1) / kObjectAlign * kObjectAlign;
+    if (rounded == 0 || rounded * kMinObjectsPerSlab > slab_size_) {
+        throw std::invalid_argument("Object size does not fit a slab cache");
+    }
+
+    auto it = cache_by_size_.find(rounded);
+    if (it != cache_by_size_.end()) {
+        return it->second;
+    }
+
+    Cache cache;
+    cache.object_size = rounded;
+    cache.objects_per_slab = static_cast<std::uint32_t>(slab_size_ / rounded);
+    cache.full_slabs = 0;
+    cache.active_objects = 0;
+
+    caches_.push_back(std::move(cache));
+    cache_by_size_[rounded] = caches_.size() - 1;
+    return caches_.size() - 1;
+}
+
+
+void SlabAllocator::list_push(std::vector<std::uint32_t>& list, Cache& cache, std::uint32_t slab) {
+    cache.slabs[slab].list_pos = static_cast<std::uint32_t>(list.size());
+    list.push_back(slab);
+}
+
+// Swap-remove, so leaving a list is O(1)
+void SlabAllocator::list_remove(std::vector<std::uint32_t>& list, Cache& cache, std::uint32_t slab) {
+    std::uint32_t pos = cache.slabs[slab].list_pos;
+    list[pos] = list.back();
+    cache.slabs[list[pos]].list_pos = pos;
+    list.pop_back();
+    cache.slabs[slab].list_pos = kNoList;
+}
+
+bool SlabAllocator::grow(Cache& cache) {
+    std::size_t addr = buddy_.allocate_buddy(slab_size_);
+    if (addr == static_cast<std::size_t>(-1)) {
+        return false;
+    }
+
+    std::uint32_t index;
+    if (!cache.spare_slabs.empty()) {
+        index = cache.spare_slabs.back();
+        cache.spare_slabs.pop_back();
+    } else {
+        index = static_cast<std::uint32_t>(cache.slabs.size());
+        cache.slabs.emplace_back();
+    }
+
+    Slab& slab = cache.slabs[index];
+    slab.addr = addr;
+    slab.in_use = 0;
+    slab.free_objects.clear();
+    // Reverse order so objects are handed out from the start of the slab
+    for (std::uint32_t obj = cache.objects_per_slab; obj-- > 0;) {
+        slab.free_objects.push_back(obj);
+    }
+
+    list_push(cache.empty, cache, index);
+    return true;
+}
+
+void SlabAllocator::release_slab(Cache& cache, std::uint32_t slab) {
+    list_remove(cache.empty, cache, slab);
+    buddy_.free_buddy(cache.slabs[slab].addr);
+    cache.spare_slabs.push_back(slab);
+}
+
+
+BlockHandle SlabAllocator::allocate(std::size_t size) {
+    return allocate_aligned(size, kObjectAlign);
+}
+
+// Slabs start at multiples of slab_size_, so objects whose size is a
+// multiple of the alignment are all aligned: an aligned request uses the
+// cache for its size rounded up to the alignment (like SLAB_HWCACHE_ALIGN)
+BlockHandle SlabAllocator::allocate_aligned(std::size_t size, std::size_t alignment) {
+    if (size == 0 || size > buddy_.total_memory() || !is_power_of_two(alignment)) {
+        return -1;
+    }
+
+    Allocation alloc;
+    alloc.requested = size;
+    alloc.alignment = alignment;
+
+    std::size_t align = std::max(alignment, kObjectAlign);
+    std::size_t rounded = align_up(size, align);
+    if (align > slab_size_ || rounded * kMinObjectsPerSlab > slab_size_) {
+        // Too large for a slab: take a block straight from the buddy allocator
+        std::size_t before = buddy_.used_memory();
+        std::size_t addr = buddy_.allocate_buddy_aligned(size, alignment);
+        if (addr == static_cast<std::size_t>(-1)) {
+            return -1;
+        }
+        alloc.cache = kLargeCache;
+        alloc.slab = 0;
+        alloc.object = 0;
+        alloc.addr = addr;
+        slot_bytes_ += buddy_.used_memory() - before;
+    } else {
+        std::size_t index = create_cache(rounded);
+        Cache& cache = caches_[index];
+
+        if (cache.partial.empty()) {
+            if (cache.empty.empty() && !grow(cache)) {
+                return -1;
+            }
+            std::uint32_t slab = cache.empty.back();
+            list_remove(cache.empty, cache, slab);
+            list_push(cache.partial, cache, slab);
+        }
+
+        std::uint32_t slab_index = cache.partial.back();
+        Slab& slab = cache.slabs[slab_index];
+        std::uint32_t object = slab.free_objects.back();
+        slab.free_objects.pop_back();
+        ++slab.in_use;
+        ++cache.active_objects;
+
+        if (slab.free_objects.empty()) {
+            list_remove(cache.partial, cache, slab_index);
+            ++cache.full_slabs;
+        }
+
+        alloc.cache = index;
+        alloc.slab = slab_index;
+        alloc.object = object;
+        alloc.addr = slab.addr + object * cache.object_size;
+        slot_bytes_ += cache.object_size;
+    }
+
+    BlockHandle id = live_.insert(alloc);
+    requested_bytes_ += size;
+    return id;
+}
+
+void SlabAllocator::free_block(BlockHandle id) {
+    const Allocation* found = live_.find(id);
+    if (found == nullptr) {
+        return;
+    }
+
+    Allocation alloc = *found;
+    live_.erase(id);
+    requested_bytes_ -= alloc.requested;
+
+    if (alloc.cache == kLargeCache) {
+        std::size_t before = buddy_.used_memory();
+        buddy_.free_buddy(alloc.addr);
+        slot_bytes_ -= before - buddy_.used_memory();
+        return;
+    }
+
+    Cache& cache = caches_[alloc.cache];
+    Slab& slab = cache.slabs[alloc.slab];
+    bool was_full = slab.free_objects.empty();
+
+    slab.free_objects.push_back(alloc.object);
+    --slab.in_use;
+    --cache.active_objects;
+    slot_bytes_ -= cache.object_size;
+
+    if (was_full) {
+        --cache.full_slabs;
+        list_push(cache.partial, cache, alloc.slab);
+    }
+
+    if (slab.in_use == 0) {
+        list_remove(cache.partial, cache, alloc.slab);
+        list_push(cache.empty, cache, alloc.slab);
+        if (cache.empty.size() > kEmptySlabReserve) {
+            release_slab(cache, alloc.slab);
+        }
+    }
+}
+
+bool SlabAllocator::reallocate(BlockHandle id, std::size_t new_size) {
+    Allocation* alloc = live_.find(id);
+    if (alloc == nullptr || new_size == 0) {
+        return false;
+    }
+
+    if (alloc->cache != kLargeCache && new_size <= caches_[alloc->cache].object_size) {
+        requested_bytes_ = requested_bytes_ - alloc->requested + new_size;
+        alloc->requested = new_size;
+        ++realloc_stats_.in_place;
+        return true;
+    }
+
+    // Same cache-or-buddy choice as allocate_aligned makes for the new size
+    std::size_t alignment = alloc->alignment;
+    std::size_t align = std::max(alignment, kObjectAlign);
+    std::size_t rounded = align_up(new_size, align);
+    if (alloc->cache == kLargeCache &&
+        (align > slab_size_ || rounded * kMinObjectsPerSlab > slab_size_)) {
+        // Still a large block: the buddy resizes it in place when it can
+        std::size_t before = buddy_.used_memory();
+        std::size_t addr = buddy_.reallocate_buddy(alloc->addr, new_size);
+        if (addr == static_cast<std::size_t>(-1)) {
+            ++realloc_stats_.failed;
+            return false;
+        }
+        slot_bytes_ = slot_bytes_ + buddy_.used_memory() - before;
+        requested_bytes_ = requested_bytes_ - alloc->requested + new_size;
+        alloc->requested = new_size;
+        if (addr == alloc->addr) {
+            ++realloc_stats_.in_place;
+        } else {
+            alloc->addr = addr;
+            ++realloc_stats_.moved;
+        }
+        return true;
+    }
+
+    // Different cache: allocate, then swap records so `id` owns the new object
+    BlockHandle moved = allocate_aligned(new_size, alignment);
+    if (moved == -1) {
+        ++realloc_stats_.failed;
+        return false;
+    }
+    std::swap(*live_.find(moved), *live_.find(id));
+    free_block(moved);
+    ++realloc_stats_.moved;
+    return true;
+}
+
+const ReallocStats& SlabAllocator::realloc_stats() const {
+    return realloc_stats_;
+}
+
+std::size_t SlabAllocator::reclaim() {
+    std::size_t released = 0;
+    for (Cache& cache : caches_) {
+        while (!cache.empty.empty()) {
+            release_slab(cache, cache.empty.back());
+            released += slab_size_;
+        }
+    }
+    return released;
+}
+
+
+std::size_t SlabAllocator::total_memory() const {
+    return buddy_.total_memory();
+}
+
+// Everything taken from the buddy allocator, including unused slab slots
+std::size_t SlabAllocator::used_memory() const {
+    return buddy_.used_memory();
+}
+
+std::size_t SlabAllocator::free_memory() const {
+    return buddy_.free_memory();
+}
+
+std::size_t SlabAllocator::largest_free_block() const {
+    return buddy_.largest_free_block();
+}
+
+std::size_t SlabAllocator::live_allocations() const {
+    return live_.size();
+}
+
+// Waste inside the slots handed out: object alignment and buddy rounding
+double SlabAllocator::internal_fragmentation() const {
+    if (slot_bytes_ == 0) {
+        return 0.0;
+    }
+    return static_cast<double>(slot_bytes_ - requested_bytes_) /
+           static_cast<double>(slot_bytes_);
+}
+
+bool SlabAllocator::check_invariants() const {
+    if (!buddy_.check_invariants()) {
+        return false;
+    }
+
+    std::size_t slot_bytes = 0;
+    for (const Cache& cache : caches_) {
+        std::vector<bool> spare(cache.slabs.size(), false);
+        for (std::uint32_t index : cache.spare_slabs) {
+            spare[index] = true;
+        }
+
+        // List positions point back at the slab, and each list holds
+        // only slabs in its state
+        for (std::uint32_t pos = 0; pos < cache.partial.size(); ++pos) {
+            const Slab& slab = cache.slabs[cache.partial[pos]];
+            if (slab.list_pos != pos || slab.in_use == 0 || slab.free_objects.empty()) {
+                return false;
+            }
+        }
+        for (std::uint32_t pos = 0; pos < cache.empty.size(); ++pos) {
+            const Slab& slab = cache.slabs[cache.empty[pos]];
+            if (slab.list_pos != pos || slab.in_use != 0) {
+                return false;
+            }
+        }
+
+        std::size_t full = 0;
+        std::size_t active = 0;
+        for (std::size_t index = 0; index < cache.slabs.size(); ++index) {
+            if (spare[index]) {
+                continue;
+            }
+            const Slab& slab = cache.slabs[index];
+            if (slab.in_use + slab.free_objects.size() != cache.objects_per_slab) {
+                return false;
+            }
+            if (slab.free_objects.empty()) {
+                if (slab.list_pos != kNoList) {
+                    return false;
+                }
+                ++full;
+            }
+            active += slab.in_use;
+        }
+        if (full != cache.full_slabs || active != cache.active_objects) {
+            return false;
+        }
+        slot_bytes += active * cache.object_size;
+    }
+
+    std::size_t requested = 0;
+    live_.for_each([&](BlockHandle, const Allocation& alloc) {
+        requested += alloc.requested;
+        if (alloc.cache == kLargeCache) {
+            slot_bytes += static_cast<std::size_t>(1) << (alloc.requested <= 1 ? 0
+                : floor_log2(alloc.requested - 1) + 1);
+        }
+    });
+    return requested == requested_bytes_ && slot_bytes == slot_bytes_;
+}
+
+std::size_t SlabAllocator::block_start(BlockHandle id) const {
+    const Allocation* found = live_.find(id);
+    if (found == nullptr) {
+        return static_cast<std::size_t>(-1);
+    }
+    return found->addr;
+}
+
+const BuddyAllocator& SlabAllocator::backing_allocator() const {
+    return buddy_;
+}
+
+std::vector<SlabAllocator::CacheStats> SlabAllocator::cache_stats() const {
+    std::vector<CacheStats> stats;
+    for (const Cache& cache : caches_) {
+        CacheStats s;
+        s.object_size = cache.object_size;
+        s.objects_per_slab = cache.objects_per_slab;
+        s.full_slabs = cache.full_slabs;
+        s.partial_slabs = cache.partial.size();
+        s.empty_slabs = cache.empty.size();
+        s.slabs = s.full_slabs + s.partial_slabs + s.empty_slabs;
+        s.active_objects = cache.active_objects;
+        std::size_t capacity = s.slabs * s.objects_per_slab;
+        s.occupancy = capacity == 0 ? 0.0
+            : static_cast<double>(s.active_objects) / static_cast<double>(capacity);
+        stats.push_back(s);
+    }
+    return stats;
+}
+
+
+void SlabAllocator::dump() const {
+    std::cout << "Slab Caches (slab size " << slab_size_ << "):\n";
+    for (const CacheStats& s : cache_stats()) {
+        std::cout << "  size " << std::setw(5) << s.object_size
+                  << ": " << s.active_objects << " objects in " << s.slabs << " slabs"
+                  << " (full " << s.full_slabs << ", partial " << s.partial_slabs
+                  << ", empty " << s.empty_slabs << "), occupancy "
+                  << std::fixed << std::setprecision(1) << s.occupancy * 100.0 << "%\n";
+    }
+    std::cout << "\nBacking Buddy Allocator:\n";
+    buddy_.dump();
+}
+
+const char* SlabAllocator::allocator_name() const {
+    return "Slab (on Buddy)";
+}
@@ -0,0 +1,509 @@
+#include "tlsf/TlsfAllocator.h"
+#include "allocator/BitUtils.h"
+#include <iostream>
+#include <iomanip>
+#include <utility>
+
+TlsfAllocator::TlsfAllocator(std::size_t total_memory)
+    : total_memory_(total_memory), used_bytes_(0),
+      first_block_(kNil), fl_bitmap_(0), sl_bitmap_{}, realloc_stats_{0, 0, 0}
+{
+    for (unsigned fl = 0; fl < kFlCount; ++fl) {
+        for (unsigned sl = 0; sl < kSlCount; ++sl) {
+            heads_[fl][sl] = kNil;
+        }
+    }
+
+    if (total_memory_ == 0) {
+        return;
+    }
+
+    // Entire memory starts as one free block
+    first_block_ = new_record();
+    Block& initial = blocks_[first_block_];
+    initial.start = 0;
+    initial.size = total_memory_;
+    insert_free(first_block_);
+}
+
+
+// Class whose size range contains `size`
+void TlsfAllocator::mapping_insert(std::size_t size, unsigned& fl, unsigned& sl) {
+    if (size < kSmallBlockSize) {
+        fl = 0;
+        sl = static_cast<unsigned>(size);
+        return;
+    }
+
+    unsigned log2 = floor_log2(size);
+    sl = static_cast<unsigned>(size >> (log2 - kSlLog2)) ^ kSlCount;
+    fl = log2 - kFlShift;
+}
+
+// First class whose every block is at least `size` bytes
+void TlsfAllocator::mapping_search(std::size_t size, unsigned& fl, unsigned& sl) {
+    if (size >= kSmallBlockSize) {
+        std::size_t round = (static_cast<std::size_t>(1) << (floor_log2(size) - kSlLog2)) - 1;
+        if (size + round > size) {
+            size += round;
+        }
+    }
+    mapping_insert(size, fl, sl);
+}
+
+// Moves (fl, sl) to the first non-empty list at or above it
+bool TlsfAllocator::find_suitable(unsigned& fl, unsigned& sl) const {
+    std::uint32_t sl_map = sl_bitmap_[fl] & (~0u << sl);
+    if (sl_map == 0) {
+        if (fl + 1 >= kFlCount) {
+            return false;
+        }
+        std::uint64_t fl_map = fl_bitmap_ & (~0ULL << (fl + 1));
+        if (fl_map == 0) {
+            return false;
+        }
+        fl = count_trailing_zeros(fl_map);
+        sl_map = sl_bitmap_[fl];
+    }
+    sl = count_trailing_zeros(sl_map);
+    return true;
+}
+
+
+TlsfAllocator::BlockRef TlsfAllocator::new_record() {
+    BlockRef ref;
+    if (!spare_records_.empty()) {
+        ref = spare_records_.back();
+        spare_records_.pop_back();
+    } else {
+        ref = static_cast<BlockRef>(blocks_.size());
+        blocks_.emplace_back();
+    }
+
+    blocks_[ref] = Block{0, 0, true, kInvalidHandle, 1, kNil, kNil, kNil, kNil};
+    return ref;
+}
+
+void TlsfAllocator::release_record(BlockRef ref) {
+    spare_records_.push_back(ref);
+}
+
+void TlsfAllocator::insert_free(BlockRef ref) {
+    unsigned fl, sl;
+    mapping_insert(blocks_[ref].size, fl, sl);
+
+    Block& block = blocks_[ref];
+    block.free = true;
+    block.id = kInvalidHandle;
+    block.prev_free = kNil;
+    block.next_free = heads_[fl][sl];
+    if (block.next_free != kNil) {
+        blocks_[block.next_free].prev_free = ref;
+    }
+    heads_[fl][sl] = ref;
+
+    fl_bitmap_ |= 1ULL << fl;
+    sl_bitmap_[fl] |= 1u << sl;
+}
+
+void TlsfAllocator::remove_free(BlockRef ref) {
+    unsigned fl, sl;
+    mapping_insert(blocks_[ref].size, fl, sl);
+
+    Block& block = blocks_[ref];
+    if (block.prev_free != kNil) {
+        blocks_[block.prev_free].next_free = block.next_free;
+    } else {
+        heads_[fl][sl] = block.next_free;
+    }
+    if (block.next_free != kNil) {
+        blocks_[block.next_free].prev_free = block.prev_free;
+    }
+
+    if (heads_[fl][sl] == kNil) {
+        sl_bitmap_[fl] &= ~(1u << sl);
+        if (sl_bitmap_[fl] == 0) {
+            fl_bitmap_ &= ~(1ULL << fl);
+        }
+    }
+    block.free = false;
+}
+
+
+// Free block of at least `size` bytes from the first suitable class, or kNil
+TlsfAllocator::BlockRef TlsfAllocator::find_block(std::size_t size) const {
+    unsigned fl, sl;
+    mapping_search(size, fl, sl);
+
+    BlockRef ref = kNil;
+    if (fl < kFlCount && find_suitable(fl, sl)) {
+        ref = heads_[fl][sl];
+    } else {
+        // Rounding up can overshoot the largest block; the head of the
+        // request's own class may still be big enough
+        mapping_insert(size, fl, sl);
+        BlockRef head = heads_[fl][sl];
+        if (head != kNil && blocks_[head].size >= size) {
+            ref = head;
+        }
+    }
+
+    return ref;
+}
+
+BlockHandle TlsfAllocator::allocate(std::size_t size) {
+    if (size == 0 || size > total_memory_) {
+        return -1;
+    }
+
+    BlockRef ref = find_block(size);
+    if (ref == kNil) {
+        return -1;
+    }
+
+    remove_free(ref);
+    return use_block(ref, size);
+}
+
+// Searching for size + alignment - 1 keeps the lookup to two bit scans:
+// any block found fits wherever its aligned address falls. The leading
+// padding goes back on the free lists.
+BlockHandle TlsfAllocator::allocate_aligned(std::size_t size, std::size_t alignment) {
+    if (size == 0 || size > total_memory_ || !is_power_of_two(alignment)) {
+        return -1;
+    }
+
+    BlockRef ref = kNil;
+    if (alignment - 1 <= total_memory_ - size) {
+        ref = find_block(size + (alignment - 1));
+    }
+    if (ref == kNil) {
+        // An exact-size block may still happen to start aligned
+        // (e.g. the whole of an empty heap)
+        BlockRef candidate = find_block(size);
+        if (candidate != kNil && blocks_[candidate].start % alignment == 0) {
+            ref = candidate;
+        }
+    }
+    if (ref == kNil) {
+        return -1;
+    }
+
+    remove_free(ref);
+
+    std::size_t padding = align_up(blocks_[ref].start, alignment) - blocks_[ref].start;
+    if (padding > 0) {
+        BlockRef pad = new_record();
+        Block& block = blocks_[ref];
+        Block& head = blocks_[pad];
+        head.start = block.start;
+        head.size = padding;
+        head.prev_phys = block.prev_phys;
+        head.next_phys = ref;
+        if (block.prev_phys != kNil) {
+            blocks_[block.prev_phys].next_phys = pad;
+        } else {
+            first_block_ = pad;
+        }
+        block.prev_phys = pad;
+        block.start += padding;
+        block.size -= padding;
+        insert_free(pad);
+    }
+
+    BlockHandle id = use_block(ref, size);
+    blocks_[ref].alignment = alignment;
+    return id;
+}
+
+// Allocates an unlisted free block, returning any tail beyond `size`
+BlockHandle TlsfAllocator::use_block(BlockRef ref, std::size_t size) {
+    // Split off the tail as a new free block
+    if (blocks_[ref].size > size) {
+        BlockRef rest = new_record();
+        Block& block = blocks_[ref];
+        Block& tail = blocks_[rest];
+        tail.start = block.start + size;
+        tail.size = block.size - size;
+        tail.prev_phys = ref;
+        tail.next_phys = block.next_phys;
+        if (block.next_phys != kNil) {
+            blocks_[block.next_phys].prev_phys = rest;
+        }
+        block.next_phys = rest;
+        block.size = size;
+        insert_free(rest);
+    }
+
+    BlockHandle id = live_blocks_.insert(ref);
+    blocks_[ref].id = id;
+    blocks_[ref].alignment = 1;
+    used_bytes_ += blocks_[ref].size;
+    return id;
+}
+
+
+void TlsfAllocator::free_block(BlockHandle id) {
+    const BlockRef* found = live_blocks_.find(id);
+    if (found == nullptr) {
+        return;
+    }
+
+    BlockRef ref = *found;
+    live_blocks_.erase(id);
+    used_bytes_ -= blocks_[ref].size;
+
+    // Merge with previous block if free
+    BlockRef prev = blocks_[ref].prev_phys;
+    if (prev != kNil && blocks_[prev].free) {
+        remove_free(prev);
+        blocks_[prev].size += blocks_[ref].size;
+        blocks_[prev].next_phys = blocks_[ref].next_phys;
+        if (blocks_[ref].next_phys != kNil) {
+            blocks_[blocks_[ref].next_phys].prev_phys = prev;
+        }
+        release_record(ref);
+        ref = prev;
+    }
+
+    // Merge with next block if free
+    BlockRef next = blocks_[ref].next_phys;
+    if (next != kNil && blocks_[next].free) {
+        remove_free(next);
+        blocks_[ref].size += blocks_[next].size;
+        blocks_[ref].next_phys = blocks_[next].next_phys;
+        if (blocks_[next].next_phys != kNil) {
+            blocks_[blocks_[next].next_phys].prev_phys = ref;
+        }
+        release_record(next);
+    }
+
+    insert_free(ref);
+}
+
+
+bool TlsfAllocator::reallocate(BlockHandle id, std::size_t new_size) {
+    const BlockRef* found = live_blocks_.find(id);
+    if (found == nullptr || new_size == 0) {
+        return false;
+    }
+
+    BlockRef ref = *found;
+    if (new_size > blocks_[ref].size) {
+        std::size_t extra = new_size - blocks_[ref].size;
+        BlockRef next = blocks_[ref].next_phys;
+        if (next == kNil || !blocks_[next].free || blocks_[next].size < extra) {
+            // Move: `id` takes over the new block and the temporary
+            // handle frees the old one
+            BlockHandle moved = allocate_aligned(new_size, blocks_[ref].alignment);
+            if (moved == -1) {
+                ++realloc_stats_.failed;
+                return false;
+            }
+            BlockRef* moved_ref = live_blocks_.find(moved);
+            std::swap(*moved_ref, *live_blocks_.find(id));
+            blocks_[*live_blocks_.find(id)].id = id;
+            blocks_[*moved_ref].id = moved;
+            free_block(moved);
+            ++realloc_stats_.moved;
+            return true;
+        }
+
+        // Absorb the whole neighbour; release_tail gives back the excess
+        remove_free(next);
+        used_bytes_ += blocks_[next].size;
+        blocks_[ref].size += blocks_[next].size;
+        blocks_[ref].next_phys = blocks_[next].next_phys;
+        if (blocks_[next].next_phys != kNil) {
+            blocks_[blocks_[next].next_phys].prev_phys = ref;
+        }
+        release_record(next);
+    }
+
+    release_tail(ref, new_size);
+    ++realloc_stats_.in_place;
+    return true;
+}
+
+// Frees everything past `size` bytes of a used block, merging it with a
+// free next block
+void TlsfAllocator::release_tail(BlockRef ref, std::size_t size) {
+    std::size_t tail = blocks_[ref].size - size;
+    if (tail == 0) {
+        return;
+    }
+    blocks_[ref].size = size;
+    used_bytes_ -= tail;
+
+    BlockRef next = blocks_[ref].next_phys;
+    if (next != kNil && blocks_[next].free) {
+        remove_free(next);
+        blocks_[next].start -= tail;
+        blocks_[next].size += tail;
+        insert_free(next);
+        return;
+    }
+
+    BlockRef rest = new_record();
+    Block& block = blocks_[ref];
+    Block& free_tail = blocks_[rest];
+    free_tail.start = block.start + size;
+    free_tail.size = tail;
+    free_tail.prev_phys = ref;
+    free_tail.next_phys = next;
+    if (next != kNil) {
+        blocks_[next].prev_phys = rest;
+    }
+    block.next_phys = rest;
+    insert_free(rest);
+}
+
+const ReallocStats& TlsfAllocator::realloc_stats() const {
+    return realloc_stats_;
+}
+
+std::size_t TlsfAllocator::total_memory() const {
+    return total_memory_;
+}
+
+std::size_t TlsfAllocator::used_memory() const {
+    return used_bytes_;
+}
+
+std::size_t TlsfAllocator::free_memory() const {
+    return total_memory_ - used_bytes_;
+}
+
+std::size_t TlsfAllocator::largest_free_block() const {
+    if (fl_bitmap_ == 0) {
+        return 0;
+    }
+
+    // Only the highest non-empty class can hold the largest block, and
+    // every block in it is within one second-level step of the largest;
+    // its head stands in for the class rather than walking the list
+    unsigned fl = floor_log2(fl_bitmap_);
+    unsigned sl = floor_log2(sl_bitmap_[fl]);
+    return blocks_[heads_[fl][sl]].size;
+}
+
+std::size_t TlsfAllocator::live_allocations() const {
+    return live_blocks_.size();
+}
+
+std::size_t TlsfAllocator::block_start(BlockHandle id) const {
+    const BlockRef* found = live_blocks_.find(id);
+    if (found == nullptr) {
+        return static_cast<std::size_t>(-1);
+    }
+    return blocks_[*found].start;
+}
+
+
+// One walk of the physical chain and one of the class lists
+bool TlsfAllocator::check_invariants() const {
+    std::size_t expected_start = 0;
+    std::size_t used = 0;
+    std::size_t used_blocks = 0;
+    std::size_t free_blocks = 0;
+    bool prev_free = false;
+    BlockRef prev = kNil;
+
+    for (BlockRef ref = first_block_; ref != kNil; ref = blocks_[ref].next_phys) {
+        const Block& block = blocks_[ref];
+        if (block.prev_phys != prev || block.start != expected_start || block.size == 0) {
+            return false;
+        }
+        if (block.free) {
+            // Adjacent free blocks should have been merged
+            if (prev_free) {
+                return false;
+            }
+            ++free_blocks;
+        } else {
+            const BlockRef* live = live_blocks_.find(block.id);
+            if (live == nullptr || *live != ref) {
+                return false;
+            }
+            used += block.size;
+            ++used_blocks;
+        }
+        prev_free = block.free;
+        expected_start += block.size;
+        prev = ref;
+    }
+
+    if (expected_start != total_memory_ || used != used_bytes_ ||
+        used_blocks != live_blocks_.size()) {
+        return false;
+    }
+
+    // Every free block sits in the list of its own class, and the
+    // bitmaps mark exactly the non-empty lists
+    std::size_t listed = 0;
+    for (unsigned fl = 0; fl < kFlCount; ++fl) {
+        for (unsigned sl = 0; sl < kSlCount; ++sl) {
+            bool marked = (sl_bitmap_[fl] >> sl) & 1;
+            if (marked != (heads_[fl][sl] != kNil)) {
+                return false;
+            }
+            BlockRef prev_free_ref = kNil;
+            for (BlockRef ref = heads_[fl][sl]; ref != kNil; ref = blocks_[ref].next_free) {
+                unsigned block_fl, block_sl;
+                mapping_insert(blocks_[ref].size, block_fl, block_sl);
+                if (!blocks_[ref].free || blocks_[ref].prev_free != prev_free_ref ||
+                    block_fl != fl || block_sl != sl) {
+                    return false;
+                }
+                prev_free_ref = ref;
+                ++listed;
+            }
+        }
+        if (((fl_bitmap_ >> fl) & 1) != (sl_bitmap_[fl] != 0)) {
+            return false;
+        }
+    }
+    return listed == free_blocks;
+}
+
+void TlsfAllocator::dump() const {
+    for (BlockRef ref = first_block_; ref != kNil; ref = blocks_[ref].next_phys) {
+        const Block& block = blocks_[ref];
+        std::cout << "[0x" << std::hex << std::setw(4) << std::setfill('0')
+                  << block.start << " - 0x" << std::setw(4) << std::setfill('0')
+                  << (block.start + block.size - 1) << std::dec << "] ";
+
+        if (block.free) {
+            std::cout << "FREE";
+        } else {
+            std::cout << "USED (id=" << block.id << ")";
+        }
+
+        std::cout << std::endl;
+    }
+}
+
+void TlsfAllocator::dump_free_lists() const {
+    std::cout << "Free Blocks by Class (fl, sl):\n";
+    for (unsigned fl = 0; fl < kFlCount; ++fl) {
+        if ((fl_bitmap_ & (1ULL << fl)) == 0) {
+            continue;
+        }
+        for (unsigned sl = 0; sl < kSlCount; ++sl) {
+            if (heads_[fl][sl] == kNil) {
+                continue;
+            }
+            std::cout << "(" << fl << ", " << sl << "): ";
+            for (BlockRef ref = heads_[fl][sl]; ref != kNil; ref = blocks_[ref].next_free) {
+                std::cout << "0x" << std::hex << std::setw(4) << std::setfill('0')
+                          << blocks_[ref].start << std::dec
+                          << "(" << blocks_[ref].size << ") ";
+            }
+            std::cout << "\n";
+        }
+    }
+}
+
+const char* TlsfAllocator::allocator_name() const {
+    return "TLSF";
+}
@@ -21,6 +21,22 @@ public:
         test_stress_test();
         test_invariants();
         test_largest_free_block();
+        test_incremental_counters();
+        test_coalescing_with_long_free_lists();
+        test_order_rounding_and_search();
+        test_non_power_of_two_memory();
+        test_machine_sized_memory();
+        test_lazy_reuse_without_split();
+        test_lazy_coalesce_under_pressure();
+        test_lazy_watermark();
+        test_lazy_saves_list_work();
+        test_invariants_on_large_heap();
+        test_migrate_type_fallback();
+        test_pageblock_claim_rules();
+        test_grouping_preserves_high_order();
+        test_aligned_allocation();
+        test_reallocate();
+        test_batch_allocation();
         
         std::cout << "=== All BuddyAllocator Tests Passed! ===\n\n";
     }
@@ -312,6 +328,625 @@ private:
         
         std::cout << "PASSED\n";
     }
+
+    static void test_coalescing_with_long_free_lists() {
+        std::cout << "Testing coalescing with long free lists... ";
+        BuddyAllocator buddy(4096);
+
+        // Fill memory with order-0 blocks
+        std::vector<size_t> addrs;
+        for (int i = 0; i < 4096; ++i) {
+            size_t addr = buddy.allocate_buddy(1);
+            assert(addr != static_cast<size_t>(-1));
+            addrs.push_back(addr);
+        }
+
+        // Free every even block: 2048 order-0 blocks, none mergeable
+        for (size_t i = 0; i < addrs.size(); i += 2) {
+            buddy.free_buddy(addrs[i]);
+        }
+        assert(buddy.free_memory() == 2048);
+        assert(buddy.largest_free_block() == 1);
+        assert(buddy.check_no_free_buddy_pairs());
+
+        // Each odd free finds its buddy in the middle of the order-0 list
+        for (size_t i = 1; i < addrs.size(); i += 2) {
+            buddy.free_buddy(addrs[i]);
+        }
+        assert(buddy.free_memory() == 4096);
+        assert(buddy.largest_free_block() == 4096);
+        assert(buddy.check_no_overlaps());
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_order_rounding_and_search() {
+        std::cout << "Testing order rounding and free-order search... ";
+        BuddyAllocator buddy(4096);
+
+        buddy.allocate_buddy(1);      // order 0
+        assert(buddy.allocated_memory() == 1);
+        buddy.allocate_buddy(3);      // rounds to 4
+        assert(buddy.allocated_memory() == 5);
+        buddy.allocate_buddy(1025);   // rounds to 2048
+        assert(buddy.allocated_memory() == 2053);
+
+        // Free orders left by the splits: 1, 2, 3 .. 10 (0 was reused)
+        assert(buddy.largest_free_block() == 1024);
+        size_t addr = buddy.allocate_buddy(1024);
+        assert(addr != static_cast<size_t>(-1));
+        assert(buddy.largest_free_block() == 512);
+
+        // Nothing of order 11 is left
+        assert(buddy.allocate_buddy(2048) == static_cast<size_t>(-1));
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_non_power_of_two_memory() {
+        std::cout << "Testing non-power-of-two memory... ";
+        // 48 bytes = 32-byte top block at 0 + 16-byte top block at 32
+        BuddyAllocator buddy(48);
+        assert(buddy.total_memory() == 48);
+        assert(buddy.free_memory() == 48);
+        assert(buddy.largest_free_block() == 32);
+
+        size_t a = buddy.allocate_buddy(32);
+        size_t b = buddy.allocate_buddy(16);
+        assert(a == 0);
+        assert(b == 32);
+        assert(buddy.free_memory() == 0);
+        assert(buddy.allocate_buddy(1) == static_cast<size_t>(-1));
+
+        // The 16-byte block has no buddy in memory and must stay order 4
+        buddy.free_buddy(b);
+        assert(buddy.largest_free_block() == 16);
+        buddy.free_buddy(a);
+        assert(buddy.largest_free_block() == 32);
+        assert(buddy.free_memory() == 48);
+        assert(buddy.check_no_overlaps());
+        assert(buddy.check_no_free_buddy_pairs());
+
+        // 3 KiB: blocks split from both top-level trees never merge across them
+        BuddyAllocator odd(3072);
+        std::vector<size_t> addrs;
+        size_t addr;
+        while ((addr = odd.allocate_buddy(512)) != static_cast<size_t>(-1)) {
+            assert(addr + 512 <= 3072);
+            addrs.push_back(addr);
+        }
+        assert(addrs.size() == 6);
+        for (size_t a2 : addrs) {
+            odd.free_buddy(a2);
+        }
+        assert(odd.free_memory() == 3072);
+        assert(odd.largest_free_block() == 2048);
+        assert(odd.allocate_buddy(2048) == 0);
+        assert(odd.allocate_buddy(1024) == 2048);
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_machine_sized_memory() {
+        std::cout << "Testing machine-sized memory... ";
+        // 3 GiB simulates without padding to 4 GiB
+        const size_t gib = static_cast<size_t>(1) << 30;
+        BuddyAllocator buddy(3 * gib);
+        assert(buddy.total_memory() == 3 * gib);
+        assert(buddy.free_memory() == 3 * gib);
+
+        size_t big = buddy.allocate_buddy(2 * gib);
+        size_t rest = buddy.allocate_buddy(gib);
+        assert(big == 0);
+        assert(rest == 2 * gib);
+        assert(buddy.allocate_buddy(4096) == static_cast<size_t>(-1));
+
+        buddy.free_buddy(rest);
+        buddy.free_buddy(big);
+        assert(buddy.free_memory() == 3 * gib);
+        assert(buddy.largest_free_block() == 2 * gib);
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_lazy_reuse_without_split() {
+        std::cout << "Testing lazy reuse without split... ";
+        BuddyAllocator buddy(1024, CoalescingMode::LAZY);
+        assert(buddy.coalescing_mode() == CoalescingMode::LAZY);
+
+        size_t a = buddy.allocate_buddy(64);
+        assert(buddy.coalescing_stats().splits == 4);  // 1024 -> 64
+
+        // The freed block stays at order 6 instead of merging back up
+        buddy.free_buddy(a);
+        assert(buddy.deferred_blocks() == 1);
+        assert(buddy.coalescing_stats().merges == 0);
+        assert(buddy.largest_free_block() == 512);
+
+        // ...and the next 64-byte request takes it without splitting
+        assert(buddy.allocate_buddy(64) == a);
+        assert(buddy.coalescing_stats().splits == 4);
+        assert(buddy.coalescing_stats().deferred_reuses == 1);
+        assert(buddy.deferred_blocks() == 0);
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_lazy_coalesce_under_pressure() {
+        std::cout << "Testing lazy coalescing under pressure... ";
+        BuddyAllocator buddy(1024, CoalescingMode::LAZY);
+
+        std::vector<size_t> addrs;
+        for (int i = 0; i < 16; ++i) {
+            addrs.push_back(buddy.allocate_buddy(64));
+        }
+        for (size_t addr : addrs) {
+            buddy.free_buddy(addr);
+        }
+        assert(buddy.deferred_blocks() == 16);
+        assert(buddy.free_memory() == 1024);
+        assert(buddy.largest_free_block() == 64);
+
+        // No block is big enough until the deferred ones are merged
+        assert(buddy.allocate_buddy(1024) == 0);
+        assert(buddy.coalescing_stats().coalesce_passes == 1);
+        assert(buddy.coalescing_stats().merges == 15);
+        assert(buddy.deferred_blocks() == 0);
+
+        // An explicit coalesce() restores a fully merged heap
+        buddy.free_buddy(0);
+        buddy.allocate_buddy(32);
+        buddy.free_buddy(0);
+        assert(buddy.deferred_blocks() == 1);
+        buddy.coalesce();
+        assert(buddy.largest_free_block() == 1024);
+        assert(buddy.check_no_overlaps());
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_lazy_watermark() {
+        std::cout << "Testing lazy watermark... ";
+        BuddyAllocator buddy(1024, CoalescingMode::LAZY, 2);
+
+        size_t a = buddy.allocate_buddy(256);
+        size_t b = buddy.allocate_buddy(256);
+        size_t c = buddy.allocate_buddy(256);
+        size_t d = buddy.allocate_buddy(256);
+
+        buddy.free_buddy(a);
+        buddy.free_buddy(c);
+        assert(buddy.deferred_blocks() == 2);
+
+        // At the watermark, frees merge eagerly again (and absorb deferred buddies)
+        buddy.free_buddy(b);
+        assert(buddy.deferred_blocks() == 1);
+        assert(buddy.largest_free_block() == 512);
+
+        // Back under the watermark, so this free is deferred again
+        buddy.free_buddy(d);
+        assert(buddy.deferred_blocks() == 2);
+        assert(buddy.coalesce() == 2);
+        assert(buddy.largest_free_block() == 1024);
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_lazy_saves_list_work() {
+        std::cout << "Testing lazy mode saves splits and merges... ";
+        BuddyAllocator eager(1 << 20);
+        BuddyAllocator lazy(1 << 20, CoalescingMode::LAZY);
+
+        // Churn: bursts of small allocations, then frees down to a small live set
+        std::vector<size_t> live_eager;
+        std::vector<size_t> live_lazy;
+        unsigned seed = 7;
+        auto next = [&seed]() {
+            seed = seed * 1103515245u + 12345u;
+            return seed >> 16;
+        };
+        for (int round = 0; round < 1000; ++round) {
+            unsigned burst = 1 + next() % 32;
+            for (unsigned i = 0; i < burst; ++i) {
+                size_t size = static_cast<size_t>(16) << (next() % 4);
+                live_eager.push_back(eager.allocate_buddy(size));
+                live_lazy.push_back(lazy.allocate_buddy(size));
+            }
+            while (live_eager.size() > 16) {
+                size_t victim = next() % live_eager.size();
+                eager.free_buddy(live_eager[victim]);
+                lazy.free_buddy(live_lazy[victim]);
+                live_eager[victim] = live_eager.back();
+                live_eager.pop_back();
+                live_lazy[victim] = live_lazy.back();
+                live_lazy.pop_back();
+            }
+            assert(eager.used_memory() == lazy.used_memory());
+        }
+
+        const BuddyAllocator::CoalescingStats& e = eager.coalescing_stats();
+        const BuddyAllocator::CoalescingStats& l = lazy.coalescing_stats();
+        std::cout << "\n  [ACTUAL]   eager splits+merges = " << e.splits + e.merges
+                  << ", list ops = " << e.list_ops << "\n";
+        std::cout << "  [ACTUAL]   lazy  splits+merges = " << l.splits + l.merges
+                  << ", list ops = " << l.list_ops << "\n";
+        assert(l.splits + l.merges < (e.splits + e.merges) / 2);
+        assert(l.list_ops < e.list_ops);
+        assert(l.deferred_reuses > 0);
+
+        for (size_t addr : live_lazy) {
+            lazy.free_buddy(addr);
+        }
+        lazy.coalesce();
+        assert(lazy.largest_free_block() == lazy.total_memory());
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_invariants_on_large_heap() {
+        std::cout << "Testing invariant checks on a 1 GiB heap... ";
+        // The checks cost O(blocks log blocks), not O(bytes)
+        for (CoalescingMode mode : {CoalescingMode::EAGER, CoalescingMode::LAZY}) {
+            BuddyAllocator buddy(static_cast<size_t>(1) << 30, mode);
+            assert(buddy.check_invariants());
+
+            std::vector<BlockHandle> live;
+            unsigned seed = 3;
+            for (int op = 0; op < 20000; ++op) {
+                seed = seed * 1103515245u + 12345u;
+                if (live.empty() || (seed >> 16) % 3 != 0) {
+                    BlockHandle id = buddy.allocate(static_cast<size_t>(1) << (8 + (seed >> 8) % 12));
+                    if (id != -1) {
+                        live.push_back(id);
+                    }
+                } else {
+                    size_t victim = (seed >> 4) % live.size();
+                    buddy.free_block(live[victim]);
+                    live[victim] = live.back();
+                    live.pop_back();
+                }
+                if (op % 500 == 0) {
+                    assert(buddy.check_invariants());
+                }
+            }
+            assert(buddy.check_no_overlaps());
+            assert(buddy.check_no_free_buddy_pairs());
+            assert(buddy.check_invariants());
+        }
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_migrate_type_fallback() {
+        std::cout << "Testing migrate-type fallback... ";
+        BuddyAllocator buddy(64 * 1024);
+        assert(buddy.pageblock_order() == 12);
+        assert(buddy.pageblock_type(0) == MigrateType::MOVABLE);
+
+        // No unmovable pageblocks yet: steal one whole 4 KiB pageblock,
+        // leaving the rest of memory movable
+        size_t pinned = buddy.allocate_buddy(256, MigrateType::UNMOVABLE);
+        assert(pinned == 0);
+        assert(buddy.pageblock_type(0) == MigrateType::UNMOVABLE);
+        assert(buddy.pageblock_type(4096) == MigrateType::MOVABLE);
+        assert(buddy.mobility_stats().fallbacks == 1);
+        assert(buddy.mobility_stats().pageblocks_claimed == 1);
+
+        // Later unmovable requests stay in that pageblock, movable ones avoid it
+        size_t pinned2 = buddy.allocate_buddy(256, MigrateType::UNMOVABLE);
+        assert(pinned2 < 4096);
+        BlockHandle id = buddy.allocate(1024);
+        assert(buddy.block_start(id) >= 4096);
+        assert(buddy.mobility_stats().fallbacks == 1);
+        assert(buddy.check_invariants());
+
+        // The pageblock size is fixed once anything is allocated
+        assert(!buddy.set_pageblock_order(10));
+        buddy.free_buddy(pinned);
+        buddy.free_buddy(pinned2);
+        buddy.free_block(id);
+        assert(buddy.largest_free_block() == 64 * 1024);
+        assert(buddy.set_pageblock_order(10));
+        assert(!buddy.set_pageblock_order(17));
+        assert(buddy.pageblock_type(0) == MigrateType::MOVABLE);
+        assert(buddy.check_invariants());
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_pageblock_claim_rules() {
+        std::cout << "Testing pageblock claim rules... ";
+        BuddyAllocator buddy(16 * 1024);
+        assert(buddy.set_pageblock_order(12));
+
+        // Make every pageblock reclaimable, then free all but one block
+        std::vector<size_t> blocks;
+        for (int i = 0; i < 4; ++i) {
+            blocks.push_back(buddy.allocate_buddy(4096, MigrateType::RECLAIMABLE));
+        }
+        for (int i = 0; i < 4; ++i) {
+            assert(buddy.pageblock_type(i * 4096) == MigrateType::RECLAIMABLE);
+        }
+        assert(buddy.allocate_buddy(64, MigrateType::RECLAIMABLE) == static_cast<size_t>(-1));
+        buddy.free_buddy(blocks[3]);
+
+        // Fill the last pageblock down to one free 32-byte block
+        std::vector<size_t> pieces;
+        for (size_t size = 2048; size >= 32; size /= 2) {
+            pieces.push_back(buddy.allocate_buddy(size, MigrateType::RECLAIMABLE));
+            assert(pieces.back() >= 3 * 4096);
+        }
+
+        // A small movable steal borrows the block but leaves the pageblock alone
+        size_t claims = buddy.mobility_stats().pageblocks_claimed;
+        size_t borrowed = buddy.allocate_buddy(16);
+        assert(borrowed != static_cast<size_t>(-1));
+        assert(buddy.pageblock_type(3 * 4096) == MigrateType::RECLAIMABLE);
+        assert(buddy.mobility_stats().pageblocks_claimed == claims);
+
+        // An unmovable steal claims the pageblock and its free blocks
+        buddy.free_buddy(pieces[5]);  // the 64-byte block
+        size_t claimed = buddy.allocate_buddy(64, MigrateType::UNMOVABLE);
+        assert(claimed == pieces[5]);
+        assert(buddy.pageblock_type(3 * 4096) == MigrateType::UNMOVABLE);
+        assert(buddy.mobility_stats().pageblocks_claimed == claims + 1);
+        assert(buddy.check_invariants());
+
+        std::cout << "PASSED\n";
+    }
+
+    // Fills memory with short-lived movable data and slowly turning over
+    // pinned objects, reclaims the movable data, then tries 32 KiB requests
+    static double high_order_rate_after_reclaim(bool grouped, size_t& windows) {
+        BuddyAllocator buddy(1 << 20);
+        buddy.set_pageblock_order(13);
+        MigrateType pinned_type = grouped ? MigrateType::UNMOVABLE : MigrateType::MOVABLE;
+
+        unsigned seed = 11;
+        std::vector<size_t> movable;
+        std::vector<size_t> pinned;
+        for (int cycle = 0; cycle < 30; ++cycle) {
+            while (buddy.used_memory() < buddy.total_memory() * 9 / 10) {
+                seed = seed * 1103515245u + 12345u;
+                size_t addr;
+                if ((seed >> 16) % 8 == 0) {
+                    addr = buddy.allocate_buddy(64 << ((seed >> 8) % 3), pinned_type);
+                    if (addr == static_cast<size_t>(-1)) {
+                        break;
+                    }
+                    pinned.push_back(addr);
+                    if (pinned.size() > 700) {
+                        buddy.free_buddy(pinned[(seed >> 4) % pinned.size()]);
+                        pinned[(seed >> 4) % pinned.size()] = pinned.back();
+                        pinned.pop_back();
+                    }
+                } else {
+                    addr = buddy.allocate_buddy(256 << ((seed >> 8) % 5));
+                    if (addr == static_cast<size_t>(-1)) {
+                        break;
+                    }
+                    movable.push_back(addr);
+                }
+            }
+            for (size_t addr : movable) {
+                buddy.free_buddy(addr);
+            }
+            movable.clear();
+
+            std::vector<size_t> high;
+            for (int i = 0; i < 10; ++i) {
+                size_t addr = buddy.allocate_buddy(32 * 1024);
+                if (addr != static_cast<size_t>(-1)) {
+                    high.push_back(addr);
+                }
+            }
+            for (size_t addr : high) {
+                buddy.free_buddy(addr);
+            }
+        }
+        assert(buddy.check_invariants());
+        assert(buddy.mobility_stats().high_order_attempts == 300);
+        windows = buddy.high_order_history().size();
+        return buddy.high_order_success_rate();
+    }
+
+    static void test_grouping_preserves_high_order() {
+        std::cout << "Testing grouping preserves high-order blocks... ";
+        size_t windows = 0;
+        double ungrouped = high_order_rate_after_reclaim(false, windows);
+        double grouped = high_order_rate_after_reclaim(true, windows);
+        std::cout << "\n  [ACTUAL]   high-order success ungrouped = " << ungrouped
+                  << ", grouped = " << grouped << "\n";
+        // Pinned objects scattered through memory pin most 32 KiB blocks;
+        // grouped, they share a few pageblocks
+        assert(grouped > ungrouped + 0.3);
+        assert(windows == 300 / BuddyAllocator::kHighOrderWindow);
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_incremental_counters() {
+        std::cout << "Testing incremental memory counters... ";
+        BuddyAllocator buddy(4096);
+
+        BlockHandle id1 = buddy.allocate(100);   // rounds to 128
+        BlockHandle id2 = buddy.allocate(512);   // exact
+        assert(buddy.live_allocations() == 2);
+        assert(buddy.used_memory() == 640);
+        assert(buddy.free_memory() == 4096 - 640);
+
+        // 28 of the 640 allocated bytes are rounding waste
+        double expected = 28.0 / 640.0;
+        assert(std::fabs(buddy.internal_fragmentation() - expected) < 1e-9);
+
+        buddy.free_block(id1);
+        assert(buddy.live_allocations() == 1);
+        assert(buddy.used_memory() == 512);
+        assert(buddy.internal_fragmentation() == 0.0);
+
+        buddy.free_block(id2);
+        assert(buddy.live_allocations() == 0);
+        assert(buddy.free_memory() == 4096);
+        assert(buddy.external_fragmentation() == 0.0);
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_aligned_allocation() {
+        std::cout << "Testing aligned allocation... ";
+        BuddyAllocator buddy(64 * 1024);
+
+        // Blocks are aligned to their own size: small alignments are free
+        BlockHandle a = buddy.allocate_aligned(100, 64);
+        assert(buddy.block_start(a) % 128 == 0);
+        assert(buddy.used_memory() == 128);
+
+        // A larger alignment splits from its own order but still hands
+        // out only the rounded size
+        BlockHandle b = buddy.allocate_aligned(100, 4096);
+        assert(b != -1);
+        assert(buddy.block_start(b) % 4096 == 0);
+        assert(buddy.used_memory() == 256);
+        assert(buddy.check_invariants());
+
+        size_t addr = buddy.allocate_buddy_aligned(32, 16 * 1024);
+        assert(addr % (16 * 1024) == 0);
+
+        assert(buddy.allocate_aligned(64, 24) == -1);
+        assert(buddy.allocate_aligned(64, 128 * 1024) == -1);
+
+        buddy.free_buddy(addr);
+        buddy.free_block(a);
+        buddy.free_block(b);
+        assert(buddy.largest_free_block() == 64 * 1024);
+        assert(buddy.check_invariants());
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_reallocate() {
+        std::cout << "Testing reallocate... ";
+        BuddyAllocator buddy(1024);
+
+        // Grows by absorbing the free upper buddy
+        BlockHandle a = buddy.allocate(100);
+        assert(buddy.reallocate(a, 250));
+        assert(buddy.block_start(a) == 0);
+        assert(buddy.used_memory() == 256);
+
+        // Shrinks by splitting; the freed halves cannot merge
+        assert(buddy.reallocate(a, 60));
+        assert(buddy.used_memory() == 64);
+        assert(buddy.check_no_free_buddy_pairs());
+        assert(buddy.realloc_stats().in_place == 2);
+        assert(buddy.check_invariants());
+
+        // The upper buddy is taken, so growing moves the block
+        BlockHandle b = buddy.allocate(64);
+        assert(buddy.block_start(b) == 64);
+        assert(buddy.reallocate(a, 128));
+        assert(buddy.block_start(a) == 128);
+        assert(buddy.realloc_stats().moved == 1);
+        assert(buddy.used_memory() == 192);
+        assert(buddy.check_invariants());
+
+        // An upper half cannot grow in place even with a free neighbour
+        buddy.free_block(b);
+        assert(buddy.reallocate(a, 256));
+        assert(buddy.block_start(a) != 128);
+
+        assert(!buddy.reallocate(a, 2048));
+        assert(buddy.realloc_stats().failed == 1);
+        assert(buddy.check_invariants());
+
+        // A moved block keeps its alignment, in LAZY mode as well
+        for (CoalescingMode mode : {CoalescingMode::EAGER, CoalescingMode::LAZY}) {
+            BuddyAllocator aligned(4096, mode);
+            aligned.allocate(32);
+            BlockHandle c = aligned.allocate_aligned(32, 512);
+            aligned.allocate(32);
+            assert(aligned.block_start(c) == 512);
+            assert(aligned.reallocate(c, 100));
+            assert(aligned.block_start(c) != 512);
+            assert(aligned.block_start(c) % 512 == 0);
+            assert(aligned.check_invariants());
+        }
+
+        // ... and its mobility class
+        BuddyAllocator typed(16384);
+        assert(typed.set_pageblock_order(10));
+        BlockHandle pinned = typed.allocate(64, MigrateType::UNMOVABLE);
+        typed.allocate(64, MigrateType::UNMOVABLE);
+        typed.allocate(128, MigrateType::UNMOVABLE);
+        assert(typed.reallocate(pinned, 200));
+        assert(typed.pageblock_type(typed.block_start(pinned)) == MigrateType::UNMOVABLE);
+        assert(typed.check_invariants());
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_batch_allocation() {
+        std::cout << "Testing batch allocation... ";
+        BuddyAllocator buddy(4096);
+
+        // Five 64-byte requests split one 512-byte block; the three unused
+        // pieces go back as a 64 and a 128
+        std::vector<size_t> sizes = {60, 64, 50, 33, 64, 1000, 0, 8192};
+        std::vector<BlockHandle> out(sizes.size());
+        assert(buddy.allocate_batch(sizes.data(), sizes.size(), out.data()) == 6);
+        for (size_t i = 0; i < 5; ++i) {
+            assert(buddy.block_start(out[i]) == i * 64);
+        }
+        assert(buddy.block_start(out[5]) == 1024);
+        assert(out[6] == kInvalidHandle && out[7] == kInvalidHandle);
+        assert(buddy.used_memory() == 5 * 64 + 1024);
+        assert(buddy.check_no_free_buddy_pairs());
+        assert(buddy.check_invariants());
+
+        // The leftover pieces serve later single calls
+        assert(buddy.block_start(buddy.allocate(64)) == 320);
+        assert(buddy.block_start(buddy.allocate(128)) == 384);
+
+        buddy.free_batch(out.data(), out.size());
+        assert(buddy.used_memory() == 192);
+        assert(buddy.check_invariants());
+
+        // Free blocks of the exact order are used before anything is split,
+        // so a batch fragments no more than single calls
+        BuddyAllocator single(4096);
+        BuddyAllocator batched(4096);
+        for (BuddyAllocator* heap : {&single, &batched}) {
+            std::vector<BlockHandle> held;
+            for (int i = 0; i < 8; ++i) {
+                held.push_back(heap->allocate(64));
+            }
+            for (size_t i = 0; i < held.size(); i += 2) {
+                heap->free_block(held[i]);  // four 64-byte holes
+            }
+        }
+        std::vector<size_t> small(5, 64);
+        std::vector<BlockHandle> placed(small.size());
+        assert(batched.allocate_batch(small.data(), small.size(), placed.data()) == 5);
+        for (size_t i = 0; i < small.size(); ++i) {
+            assert(batched.block_start(placed[i]) == single.block_start(single.allocate(64)));
+        }
+        assert(batched.largest_free_block() == single.largest_free_block());
+        assert(batched.coalescing_stats().splits == single.coalescing_stats().splits);
+        assert(batched.check_invariants());
+
+        // A run bigger than any free block is spread over several
+        BuddyAllocator full(4096);
+        std::vector<size_t> pages(20, 256);
+        std::vector<BlockHandle> ids(pages.size());
+        assert(full.allocate_batch(pages.data(), pages.size(), ids.data()) == 16);
+        assert(full.free_memory() == 0);
+        assert(ids[16] == kInvalidHandle);
+        full.free_batch(ids.data(), ids.size());
+        assert(full.largest_free_block() == 4096);
+        assert(full.check_invariants());
+
+        std::cout << "PASSED\n";
+    }
 };
 
 int main() {
@@ -2,6 +2,9 @@
 #include <iostream>
 #include <cassert>
 #include <vector>
+#include <stdexcept>
+#include <string>
+#include <random>
 
 class DirectMappedCacheTests {
 public:
@@ -20,6 +23,12 @@ public:
         test_conflict_misses();
         test_cache_size_variations();
         test_line_size_variations();
+        test_replacement_policies();
+        test_fill_of_resident_line();
+        test_wide_sets();
+        test_vectorized_lookup();
+        test_write_policies();
+        test_batch_access();
         
         std::cout << "=== All DirectMappedCache Tests Passed! ===\n\n";
     }
@@ -305,6 +314,218 @@ private:
         
         std::cout << "PASSED\n";
     }
+
+    static void test_replacement_policies() {
+        std::cout << "Testing replacement policies... ";
+
+        // One 4-way set; lines A-E all map to it
+        const uint64_t A = 0x000, B = 0x100, C = 0x200, D = 0x300, E = 0x400;
+        auto warm = [&](DirectMappedCache& cache) {
+            for (uint64_t addr : {A, B, C, D, A}) {
+                cache.access(addr);
+            }
+            cache.access(E);
+        };
+
+        // FIFO ignores the hit on A and evicts it
+        DirectMappedCache fifo(256, 64, 4, ReplacementPolicy::FIFO);
+        warm(fifo);
+        assert(fifo.hits() == 1);
+        assert(!fifo.access(A));
+
+        // LRU evicts B, the least recently used
+        DirectMappedCache lru(256, 64, 4, ReplacementPolicy::LRU);
+        warm(lru);
+        assert(lru.access(A) && lru.access(C) && lru.access(D));
+        assert(!lru.access(B));
+
+        // Tree-PLRU: the hit on A sends the victim path to the C/D half,
+        // and the fill of D points that subtree at C
+        DirectMappedCache plru(256, 64, 4, ReplacementPolicy::TREE_PLRU);
+        warm(plru);
+        assert(plru.access(A) && plru.access(B) && plru.access(D));
+        assert(!plru.access(C));
+
+        // A hot line between streaming lines survives under recency policies
+        for (ReplacementPolicy policy : {ReplacementPolicy::FIFO, ReplacementPolicy::LRU,
+                                         ReplacementPolicy::TREE_PLRU, ReplacementPolicy::RANDOM}) {
+            DirectMappedCache cache(1024, 64, 16, policy);
+            size_t hot_hits = 0;
+            for (uint64_t i = 1; i <= 200; ++i) {
+                hot_hits += cache.access(0) ? 1 : 0;
+                cache.access(i * 1024);
+            }
+            if (policy == ReplacementPolicy::LRU || policy == ReplacementPolicy::TREE_PLRU) {
+                assert(hot_hits == 199);
+            } else {
+                assert(hot_hits < 199);
+            }
+            assert(cache.replacement_policy() == policy);
+        }
+
+        bool threw = false;
+        try { DirectMappedCache bad(192, 64, 3, ReplacementPolicy::TREE_PLRU); }
+        catch (const std::invalid_argument&) { threw = true; }
+        assert(threw);
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_fill_of_resident_line() {
+        std::cout << "Testing fill of a resident line... ";
+        DirectMappedCache cache(128, 64, 2);  // one 2-way set
+
+        // access() already installed each line; fill() must not duplicate it
+        cache.access(0x000);
+        cache.fill(0x000);
+        cache.access(0x080);
+        cache.fill(0x080);
+        assert(cache.access(0x000));
+        assert(cache.access(0x080));
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_wide_sets() {
+        std::cout << "Testing sets wider than 64 ways... ";
+        // Fully associative: one set of 128 ways spans two valid-bit words
+        DirectMappedCache cache(128 * 64, 64, 128, ReplacementPolicy::LRU);
+        assert(cache.num_sets() == 1);
+
+        for (uint64_t line = 0; line < 128; ++line) {
+            assert(!cache.access(line * 64));
+        }
+        for (uint64_t line = 0; line < 128; ++line) {
+            assert(cache.access(line * 64));
+        }
+
+        // Line 0 is least recently used and goes first
+        assert(!cache.access(128 * 64));
+        assert(!cache.access(0));
+        assert(cache.access(127 * 64));
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_vectorized_lookup() {
+        std::cout << "Testing vectorized tag lookup... ";
+        std::mt19937_64 rng(3);
+        std::vector<uint64_t> trace(20000);
+        for (uint64_t& addr : trace) {
+            addr = rng() % (64 * 1024);
+        }
+
+        // The SIMD and scalar lookups agree on every access, for widths
+        // that leave partial vectors and for sets over 64 ways
+        for (size_t ways : {2, 4, 6, 16, 32, 96}) {
+            for (ReplacementPolicy policy : {ReplacementPolicy::FIFO, ReplacementPolicy::LRU}) {
+                DirectMappedCache scalar(ways * 64 * 8, 64, ways, policy);
+                DirectMappedCache vector(ways * 64 * 8, 64, ways, policy);
+                scalar.set_vectorized_lookup(false);
+                vector.set_vectorized_lookup(true);
+                assert(std::string(scalar.lookup_kernel()) == "scalar");
+
+                for (uint64_t addr : trace) {
+                    assert(scalar.access(addr) == vector.access(addr));
+                }
+                assert(scalar.hits() == vector.hits());
+            }
+        }
+
+        // Narrow sets keep the scalar loop by default
+        DirectMappedCache narrow(1024, 64, 2);
+        assert(std::string(narrow.lookup_kernel()) == "scalar");
+
+        std::cout << "PASSED (" << DirectMappedCache(4096, 64, 16).lookup_kernel() << ")\n";
+    }
+
+    static void test_write_policies() {
+        std::cout << "Testing write policies and dirty lines... ";
+
+        // Write-back, write-allocate: the write miss installs a dirty line
+        // that is written back when evicted. 8 sets of 2 ways; set 1 holds
+        // 0x1C40, 0x1E40 and 0x2040.
+        DirectMappedCache wb(1024, 64, 2);
+        AccessOutcome first = wb.access_outcome(0x1C48, AccessType::WRITE);
+        assert(!first.hit && first.allocated && !first.write_through && !first.writeback);
+        assert(wb.access(0x1E40, AccessType::IFETCH) == false);
+        AccessOutcome evicting = wb.access_outcome(0x2040, AccessType::READ);
+        assert(evicting.writeback && evicting.writeback_address == 0x1C40);
+        assert(wb.writebacks() == 1);
+
+        // A clean victim is dropped silently
+        assert(!wb.access_outcome(0x1C40, AccessType::READ).writeback);
+        assert(wb.writebacks() == 1);
+
+        // Write-through: hits stay clean and pass the write on
+        DirectMappedCache wt(1024, 64, 2);
+        wt.set_write_policy(WritePolicy::WRITE_THROUGH);
+        wt.access(0x1C40);
+        AccessOutcome through = wt.access_outcome(0x1C40, AccessType::WRITE);
+        assert(through.hit && through.write_through);
+        wt.access(0x1E40);
+        assert(!wt.access_outcome(0x2040, AccessType::READ).writeback);
+        assert(wt.writebacks() == 0 && wt.write_throughs() == 1);
+
+        // No-write-allocate: the miss leaves the cache untouched
+        DirectMappedCache nwa(1024, 64, 2);
+        nwa.set_write_policy(WritePolicy::WRITE_BACK, WriteMissPolicy::NO_WRITE_ALLOCATE);
+        AccessOutcome bypass = nwa.access_outcome(0x1C40, AccessType::WRITE);
+        assert(!bypass.hit && !bypass.allocated && bypass.write_through);
+        assert(!nwa.access(0x1C40));
+        assert(nwa.write_miss_policy() == WriteMissPolicy::NO_WRITE_ALLOCATE);
+
+        // Writes from the level above do not count as hits or misses
+        DirectMappedCache lower(1024, 64, 2);
+        assert(lower.absorb_write(0x40).allocated);
+        assert(lower.hits() == 0 && lower.misses() == 0);
+        assert(lower.access(0x40));
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_batch_access() {
+        std::cout << "Testing batched access... ";
+        std::mt19937_64 rng(9);
+        // Not a multiple of the block, so the last block is partial
+        std::vector<uint64_t> trace(DirectMappedCache::kBatchBlock * 40 + 5);
+        for (uint64_t& addr : trace) {
+            addr = rng() % (32 * 1024);
+        }
+
+        // Same hits, misses and final contents as one call per address
+        for (ReplacementPolicy policy : {ReplacementPolicy::FIFO, ReplacementPolicy::LRU,
+                                         ReplacementPolicy::TREE_PLRU,
+                                         ReplacementPolicy::RANDOM}) {
+            for (AccessType type : {AccessType::READ, AccessType::WRITE}) {
+                DirectMappedCache single(4096, 64, 4, policy);
+                DirectMappedCache batch(4096, 64, 4, policy);
+                std::vector<HitLevel> levels(trace.size());
+
+                std::vector<HitLevel> expected;
+                for (uint64_t addr : trace) {
+                    expected.push_back(single.access(addr, type) ? HitLevel::L1 : HitLevel::MEMORY);
+                }
+                size_t hits = batch.access_batch(trace.data(), trace.size(), levels.data(), type);
+                assert(levels == expected);
+                assert(hits == single.hits());
+                assert(batch.hits() == single.hits() && batch.misses() == single.misses());
+                assert(batch.writebacks() == single.writebacks());
+
+                // Both end up holding the same lines
+                for (uint64_t addr : trace) {
+                    assert(batch.access(addr) == single.access(addr));
+                }
+            }
+        }
+
+        // An empty batch touches nothing
+        DirectMappedCache empty(1024, 64, 2);
+        assert(empty.access_batch(nullptr, 0, nullptr) == 0);
+        assert(empty.hits() == 0 && empty.misses() == 0);
+
+        std::cout << "PASSED\n";
+    }
 };
 
 int main() {
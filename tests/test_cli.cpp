@@ -10,6 +10,7 @@
 #include <cassert>
 #include <string>
 #include <map>
+#include <vector>
 #include <iomanip>
 
 class CLITests {
@@ -24,6 +25,8 @@ public:
         test_allocation_failure();
         test_fragmentation_handling();
         test_integration_with_cache();
+        test_cache_write_traffic();
+        test_cache_batch_access();
         test_integration_with_virtual_memory();
         test_full_integration();
         test_small_memory_configuration();
@@ -37,18 +40,18 @@ private:
         std::cout << "\n  [DEBUG] Simulating First Fit allocator CLI\n";
         
         PhysicalMemory allocator(1024, AllocationStrategy::FIRST_FIT);
-        std::map<int, size_t> blockSizes;
+        std::map<BlockHandle, size_t> blockSizes;
         
         // Test malloc
         std::cout << "  [TEST] malloc 100\n";
-        int block1 = allocator.allocate(100);
+        BlockHandle block1 = allocator.allocate(100);
         assert(block1 != -1);
         blockSizes[block1] = 100;
         std::cout << "  [RESULT] Allocated block id=" << block1 << "\n";
         
         // Test second malloc
         std::cout << "  [TEST] malloc 200\n";
-        int block2 = allocator.allocate(200);
+        BlockHandle block2 = allocator.allocate(200);
         assert(block2 != -1);
         blockSizes[block2] = 200;
         std::cout << "  [RESULT] Allocated block id=" << block2 << "\n";
@@ -70,7 +73,7 @@ private:
         
         // Test reallocation in freed space
         std::cout << "  [TEST] malloc 50 (should use freed space)\n";
-        int block3 = allocator.allocate(50);
+        BlockHandle block3 = allocator.allocate(50);
         assert(block3 != -1);
         blockSizes[block3] = 50;
         std::cout << "  [RESULT] Allocated block id=" << block3 << "\n";
@@ -85,10 +88,10 @@ private:
         PhysicalMemory allocator(2048, AllocationStrategy::BEST_FIT);
         
         std::cout << "  [TEST] Creating fragmented memory\n";
-        int b1 = allocator.allocate(100);
-        int b2 = allocator.allocate(500);
-        int b3 = allocator.allocate(200);
-        int b4 = allocator.allocate(300);
+        BlockHandle b1 = allocator.allocate(100);
+        BlockHandle b2 = allocator.allocate(500);
+        BlockHandle b3 = allocator.allocate(200);
+        BlockHandle b4 = allocator.allocate(300);
         (void)b2; (void)b4; // Keep these allocated
         
         std::cout << "  [TEST] Freeing blocks to create gaps\n";
@@ -96,7 +99,7 @@ private:
         allocator.free_block(b3);  // 200-byte gap
         
         std::cout << "  [TEST] malloc 150 (should use 200-byte gap, best fit)\n";
-        int b5 = allocator.allocate(150);
+        BlockHandle b5 = allocator.allocate(150);
         assert(b5 != -1);
         std::cout << "  [RESULT] Successfully allocated in best fit gap\n";
         
@@ -110,7 +113,7 @@ private:
         PhysicalMemory allocator(4096, AllocationStrategy::WORST_FIT);
         
         std::cout << "  [TEST] malloc 1024\n";
-        int block1 = allocator.allocate(1024);
+        BlockHandle block1 = allocator.allocate(1024);
         assert(block1 != -1);
         
         std::cout << "  [TEST] Largest free block after allocation\n";
@@ -126,16 +129,16 @@ private:
         std::cout << "\n  [DEBUG] Simulating Buddy System allocator CLI\n";
         
         BuddyAllocator buddy(1024);
-        std::map<int, size_t> blockSizes;
+        std::map<BlockHandle, size_t> blockSizes;
         
         std::cout << "  [TEST] malloc 100 (should round to 128)\n";
-        int block1 = buddy.allocate(100);
+        BlockHandle block1 = buddy.allocate(100);
         assert(block1 != -1);
         blockSizes[block1] = 100;
         std::cout << "  [RESULT] Allocated block id=" << block1 << "\n";
         
         std::cout << "  [TEST] malloc 200 (should round to 256)\n";
-        int block2 = buddy.allocate(200);
+        BlockHandle block2 = buddy.allocate(200);
         assert(block2 != -1);
         blockSizes[block2] = 200;
         std::cout << "  [RESULT] Allocated block id=" << block2 << "\n";
@@ -161,15 +164,15 @@ private:
         PhysicalMemory allocator(512, AllocationStrategy::FIRST_FIT);
         
         std::cout << "  [TEST] malloc 256\n";
-        int block1 = allocator.allocate(256);
+        BlockHandle block1 = allocator.allocate(256);
         assert(block1 != -1);
         
         std::cout << "  [TEST] malloc 256\n";
-        int block2 = allocator.allocate(256);
+        BlockHandle block2 = allocator.allocate(256);
         assert(block2 != -1);
         
         std::cout << "  [TEST] malloc 100 (should fail - no space)\n";
-        int block3 = allocator.allocate(100);
+        BlockHandle block3 = allocator.allocate(100);
         std::cout << "  [RESULT] Allocation result: " << block3 << " (expected -1)\n";
         assert(block3 == -1);
         
@@ -177,7 +180,7 @@ private:
         allocator.free_block(block1);
         
         std::cout << "  [TEST] malloc 100 (should succeed now)\n";
-        int block4 = allocator.allocate(100);
+        BlockHandle block4 = allocator.allocate(100);
         std::cout << "  [RESULT] Allocation successful: " << (block4 != -1) << "\n";
         assert(block4 != -1);
         
@@ -191,7 +194,7 @@ private:
         PhysicalMemory allocator(1024, AllocationStrategy::FIRST_FIT);
         
         std::cout << "  [TEST] Create fragmentation pattern\n";
-        int blocks[10];
+        BlockHandle blocks[10];
         for (int i = 0; i < 10; i++) {
             blocks[i] = allocator.allocate(50);
             assert(blocks[i] != -1);
@@ -240,6 +243,87 @@ private:
         std::cout << "PASSED\n";
     }
     
+    static void test_cache_write_traffic() {
+        std::cout << "Testing cache write traffic... ";
+
+        // L1: 2 direct-mapped sets; L2: 16 direct-mapped sets
+        DirectMappedCache l1Cache(128, 64, 1);
+        DirectMappedCache l2Cache(1024, 64, 1);
+        CacheHierarchy cacheHierarchy(l1Cache, l2Cache);
+
+        cacheHierarchy.access(0x000, AccessType::WRITE);  // both miss, L1 line dirty
+        cacheHierarchy.access(0x080, AccessType::READ);   // L1 writes 0x000 back to L2
+        cacheHierarchy.access(0x400, AccessType::READ);   // L2 writes 0x000 back to memory
+
+        const CacheTraffic& traffic = cacheHierarchy.traffic();
+        assert(traffic.l1_writebacks == 1);
+        assert(traffic.l2_writebacks == 1);
+        assert(traffic.l2_to_l1_bytes == 3 * 64);
+        assert(traffic.l1_to_l2_bytes == 64);
+        assert(traffic.memory_to_l2_bytes == 3 * 64);
+        assert(traffic.l2_to_memory_bytes == 64);
+
+        // Write-through, no-write-allocate L1: every store goes to L2
+        DirectMappedCache l1Through(128, 64, 1);
+        l1Through.set_write_policy(WritePolicy::WRITE_THROUGH, WriteMissPolicy::NO_WRITE_ALLOCATE);
+        CacheHierarchy through(l1Through, DirectMappedCache(1024, 64, 1));
+        for (int i = 0; i < 3; ++i) {
+            through.access(0x000, AccessType::WRITE);
+        }
+        assert(through.l1_misses() == 3);
+        assert(through.l2_hits() == 2);
+        assert(through.traffic().l1_to_l2_bytes == 3 * CacheHierarchy::kStoreBytes);
+        assert(through.traffic().memory_to_l2_bytes == 64);
+        assert(through.traffic().l2_to_l1_bytes == 0);
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_cache_batch_access() {
+        std::cout << "Testing batched hierarchy access... ";
+
+        // L1: 4 sets of 2 ways; L2: 16 sets of 4 ways
+        auto make = [] {
+            return CacheHierarchy(DirectMappedCache(512, 64, 2),
+                                  DirectMappedCache(4096, 64, 4, ReplacementPolicy::LRU));
+        };
+        CacheHierarchy single = make();
+        CacheHierarchy batch = make();
+
+        std::vector<uint64_t> trace;
+        for (uint64_t i = 0; i < 300; ++i) {
+            trace.push_back((i * 0x1C0) % 0x3000);
+        }
+        trace.push_back(trace.back());
+
+        // Each level matches what the hit counters show for one call
+        std::vector<HitLevel> expected;
+        for (uint64_t addr : trace) {
+            size_t l1_before = single.l1_hits();
+            size_t l2_before = single.l2_hits();
+            single.access(addr, AccessType::WRITE);
+            if (single.l1_hits() > l1_before) {
+                expected.push_back(HitLevel::L1);
+            } else if (single.l2_hits() > l2_before) {
+                expected.push_back(HitLevel::L2);
+            } else {
+                expected.push_back(HitLevel::MEMORY);
+            }
+        }
+
+        std::vector<HitLevel> levels(trace.size());
+        size_t hits = batch.access_batch(trace.data(), trace.size(), levels.data(),
+                                         AccessType::WRITE);
+        assert(levels == expected);
+        assert(levels.back() == HitLevel::L1);
+        assert(hits == single.l1_hits() + single.l2_hits());
+        assert(batch.l1_misses() == single.l1_misses() && batch.l2_misses() == single.l2_misses());
+        assert(batch.traffic().l2_to_memory_bytes == single.traffic().l2_to_memory_bytes);
+        assert(batch.traffic().l1_writebacks == single.traffic().l1_writebacks);
+
+        std::cout << "PASSED\n";
+    }
+
     static void test_integration_with_virtual_memory() {
         std::cout << "Testing virtual memory integration... ";
         std::cout << "\n  [DEBUG] Testing virtual address translation\n";
@@ -280,7 +364,7 @@ private:
         VirtualMemoryManager vmManager(64, 16, 4096);
         
         std::cout << "  [TEST] malloc 1024\n";
-        int block1 = allocator.allocate(1024);
+        BlockHandle block1 = allocator.allocate(1024);
         assert(block1 != -1);
         std::cout << "  [RESULT] Block allocated: " << block1 << "\n";
         
@@ -322,7 +406,7 @@ private:
         assert(numPhysicalFrames > 0);
         
         std::cout << "  [TEST] malloc 500\n";
-        int block1 = allocator.allocate(500);
+        BlockHandle block1 = allocator.allocate(500);
         assert(block1 != -1);
         
         std::cout << "  [TEST] Virtual address access (256-byte spacing)\n";
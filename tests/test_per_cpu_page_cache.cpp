@@ -0,0 +1,250 @@
+#include "../include/buddy/PerCpuPageCache.h"
+#include "../include/buddy/BuddyAllocator.h"
+#include <iostream>
+#include <cassert>
+#include <vector>
+#include <thread>
+#include <random>
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+class PerCpuPageCacheTests {
+public:
+    static void run_all_tests() {
+        std::cout << "\n=== Running PerCpuPageCache Tests ===\n";
+
+        test_invalid_config();
+        test_refill_then_hits();
+        test_hot_and_cold_frees();
+        test_drain_above_high();
+        test_high_order_bypass();
+        test_drain_all();
+        test_concurrent_workers();
+
+        std::cout << "=== All PerCpuPageCache Tests Passed! ===\n\n";
+    }
+
+private:
+    static PageCacheConfig small_config() {
+        PageCacheConfig config;
+        config.cpus = 2;
+        config.page_size = 4096;
+        config.max_cached_order = 2;
+        config.high = 8;
+        config.batch = 4;
+        return config;
+    }
+
+    static void test_invalid_config() {
+        std::cout << "Testing invalid configuration... ";
+        BuddyAllocator zone(1 << 20);
+
+        PageCacheConfig config = small_config();
+        config.cpus = 0;
+        bool threw = false;
+        try { PerCpuPageCache cache(zone, config); } catch (const std::invalid_argument&) { threw = true; }
+        assert(threw);
+
+        config = small_config();
+        config.batch = config.high + 1;
+        threw = false;
+        try { PerCpuPageCache cache(zone, config); } catch (const std::invalid_argument&) { threw = true; }
+        assert(threw);
+
+        config = small_config();
+        config.page_size = 3000;
+        threw = false;
+        try { PerCpuPageCache cache(zone, config); } catch (const std::invalid_argument&) { threw = true; }
+        assert(threw);
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_refill_then_hits() {
+        std::cout << "Testing batch refill then cache hits... ";
+        BuddyAllocator zone(1 << 20);
+        PerCpuPageCache cache(zone, small_config());
+
+        // First allocation misses and pulls a batch of 4 frames
+        size_t first = cache.alloc_pages(0, 0);
+        assert(first != static_cast<size_t>(-1));
+        assert(zone.used_memory() == 4 * 4096);
+
+        // The other three come from the list without touching the buddy
+        for (int i = 0; i < 3; ++i) {
+            assert(cache.alloc_pages(0, 0) != static_cast<size_t>(-1));
+        }
+        assert(zone.used_memory() == 4 * 4096);
+
+        PerCpuPageCache::CpuStats stats = cache.cpu_stats(0);
+        assert(stats.alloc_misses == 1);
+        assert(stats.alloc_hits == 3);
+        assert(stats.refills == 1);
+        assert(stats.hit_rate() == 0.75);
+
+        // CPU 1 has its own empty lists
+        assert(cache.cpu_stats(1).alloc_hits == 0);
+        assert(cache.cpu_stats(1).cached_frames == 0);
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_hot_and_cold_frees() {
+        std::cout << "Testing hot and cold frees... ";
+        BuddyAllocator zone(1 << 20);
+        PerCpuPageCache cache(zone, small_config());
+
+        size_t a = cache.alloc_pages(0, 1);
+        size_t b = cache.alloc_pages(0, 1);
+        assert(a % 8192 == 0 && b % 8192 == 0);
+
+        cache.free_pages(0, b, 1, true);   // cold: back of the list
+        cache.free_pages(0, a, 1);         // hot: front of the list
+
+        // The hot frame is handed out first, the cold one last
+        assert(cache.alloc_pages(0, 1) == a);
+        size_t next = cache.alloc_pages(0, 1);
+        assert(next != b);
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_drain_above_high() {
+        std::cout << "Testing drain above the high watermark... ";
+        BuddyAllocator zone(1 << 20);
+        PerCpuPageCache cache(zone, small_config());
+
+        std::vector<size_t> frames;
+        for (int i = 0; i < 12; ++i) {
+            frames.push_back(cache.alloc_pages(0, 0));
+        }
+        assert(zone.used_memory() == 12 * 4096);
+
+        for (size_t addr : frames) {
+            cache.free_pages(0, addr, 0);
+        }
+
+        // Crossing high (8) drained one batch (4) back to the buddy
+        PerCpuPageCache::CpuStats stats = cache.cpu_stats(0);
+        assert(stats.drains == 1);
+        assert(stats.cached_frames == 8);
+        assert(zone.used_memory() == 8 * 4096);
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_high_order_bypass() {
+        std::cout << "Testing high-order bypass... ";
+        BuddyAllocator zone(1 << 20);
+        PerCpuPageCache cache(zone, small_config());
+
+        // Order 3 is above max_cached_order and goes straight to the buddy
+        size_t addr = cache.alloc_pages(1, 3);
+        assert(addr != static_cast<size_t>(-1));
+        assert(zone.used_memory() == 8 * 4096);
+        assert(cache.cpu_stats(1).alloc_misses == 0);
+
+        cache.free_pages(1, addr, 3);
+        assert(zone.used_memory() == 0);
+        assert(cache.cached_frames() == 0);
+
+        // Unknown CPUs are rejected
+        assert(cache.alloc_pages(7, 0) == static_cast<size_t>(-1));
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_drain_all() {
+        std::cout << "Testing drain_all... ";
+        BuddyAllocator zone(1 << 20);
+        {
+            PerCpuPageCache cache(zone, small_config());
+            for (unsigned cpu = 0; cpu < 2; ++cpu) {
+                for (unsigned order = 0; order <= 2; ++order) {
+                    size_t addr = cache.alloc_pages(cpu, order);
+                    cache.free_pages(cpu, addr, order);
+                }
+            }
+            assert(cache.cached_frames() == 2 * 3 * 4);
+            assert(zone.used_memory() > 0);
+
+            cache.drain_all();
+            assert(cache.cached_frames() == 0);
+            assert(zone.used_memory() == 0);
+            assert(zone.largest_free_block() == (1 << 20));
+
+            cache.alloc_pages(0, 0);
+            cache.free_pages(0, cache.alloc_pages(0, 0), 0);
+        }
+        // The destructor hands everything back too
+        assert(zone.used_memory() == 4096);
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_concurrent_workers() {
+        std::cout << "Testing concurrent workers... ";
+        BuddyAllocator zone(64 << 20);
+        PageCacheConfig config;
+        config.cpus = 4;
+        PerCpuPageCache cache(zone, config);
+
+        std::vector<std::vector<std::pair<size_t, unsigned>>> held(config.cpus);
+        std::vector<std::thread> workers;
+        for (unsigned cpu = 0; cpu < config.cpus; ++cpu) {
+            workers.emplace_back([&cache, &held, cpu]() {
+                std::mt19937 rng(cpu + 1);
+                std::vector<std::pair<size_t, unsigned>>& live = held[cpu];
+                for (int op = 0; op < 20000; ++op) {
+                    if (live.empty() || rng() % 2 == 0) {
+                        unsigned order = rng() % 5;  // mostly cached orders
+                        size_t addr = cache.alloc_pages(cpu, order);
+                        if (addr != static_cast<size_t>(-1)) {
+                            live.push_back({addr, order});
+                        }
+                    } else {
+                        size_t victim = rng() % live.size();
+                        cache.free_pages(cpu, live[victim].first, live[victim].second);
+                        live[victim] = live.back();
+                        live.pop_back();
+                    }
+                }
+            });
+        }
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+
+        // Frames held across all workers never overlap
+        std::vector<std::pair<size_t, size_t>> extents;
+        for (const auto& live : held) {
+            for (const auto& frame : live) {
+                extents.push_back({frame.first, config.page_size << frame.second});
+            }
+        }
+        std::sort(extents.begin(), extents.end());
+        for (size_t i = 1; i < extents.size(); ++i) {
+            assert(extents[i - 1].first + extents[i - 1].second <= extents[i].first);
+        }
+
+        for (unsigned cpu = 0; cpu < config.cpus; ++cpu) {
+            assert(cache.cpu_stats(cpu).hit_rate() > 0.5);
+            for (const auto& frame : held[cpu]) {
+                cache.free_pages(cpu, frame.first, frame.second);
+            }
+        }
+
+        cache.drain_all();
+        assert(zone.used_memory() == 0);
+        assert(zone.largest_free_block() == zone.total_memory());
+        assert(zone.check_no_free_buddy_pairs());
+
+        std::cout << "PASSED\n";
+    }
+};
+
+int main() {
+    PerCpuPageCacheTests::run_all_tests();
+    return 0;
+}
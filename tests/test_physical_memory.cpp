@@ -1,8 +1,10 @@
 #include "../include/allocator/PhysicalMemory.h"
+#include "../include/allocator/SlotMap.h"
 #include <iostream>
 #include <cassert>
 #include <string>
 #include <vector>
+#include <random>
 
 
 class PhysicalMemoryTests {
@@ -21,6 +23,18 @@ public:
         test_multiple_allocations();
         test_free_invalid_id();
         test_coalescing();
+        test_placement_matches_linear_scan();
+        test_block_handles_survive_merges();
+        test_next_fit_allocation();
+        test_slot_map_handles();
+        test_stale_handle_after_reuse();
+        test_compaction_relocation_map();
+        test_on_demand_compaction();
+        test_background_compaction();
+        test_aligned_allocation();
+        test_compaction_of_aligned_blocks();
+        test_reallocate();
+        test_batch_allocation();
         
         std::cout << "=== All PhysicalMemory Tests Passed! ===\n\n";
     }
@@ -55,7 +69,7 @@ private:
         PhysicalMemory pm(1024);
         
         std::cout << "  [STEP 1] Allocating 100 bytes using first-fit\n";
-        int id1 = pm.allocate_first_fit(100);
+        BlockHandle id1 = pm.allocate_first_fit(100);
         std::cout << "  [EXPECTED] id1 >= 0 (allocation successful)\n";
         std::cout << "  [ACTUAL]   id1 = " << id1 << "\n";
         assert(id1 >= 0);
@@ -69,7 +83,7 @@ private:
         assert(pm.free_memory() == 924);
         
         std::cout << "  [STEP 2] Allocating 200 bytes using first-fit\n";
-        int id2 = pm.allocate_first_fit(200);
+        BlockHandle id2 = pm.allocate_first_fit(200);
         std::cout << "  [EXPECTED] id2 >= 0 and id2 != id1\n";
         std::cout << "  [ACTUAL]   id2 = " << id2 << "\n";
         assert(id2 >= 0);
@@ -90,16 +104,16 @@ private:
         PhysicalMemory pm(1024);
         
         // Allocate and free to create fragmentation
-        int id1 = pm.allocate_best_fit(100);
+        BlockHandle id1 = pm.allocate_best_fit(100);
         (void)id1;  // Used for fragmentation setup
-        int id2 = pm.allocate_best_fit(200);
-        int id3 = pm.allocate_best_fit(150);
+        BlockHandle id2 = pm.allocate_best_fit(200);
+        BlockHandle id3 = pm.allocate_best_fit(150);
         (void)id3;  // Used for fragmentation setup
         
         pm.free_block(id2);  // Free middle block
         
         // Best fit should use the 200-byte hole for a 180-byte allocation
-        int id4 = pm.allocate_best_fit(180);
+        BlockHandle id4 = pm.allocate_best_fit(180);
         assert(id4 >= 0);
         
         std::cout << "PASSED\n";
@@ -109,11 +123,11 @@ private:
         std::cout << "Testing worst-fit allocation... ";
         PhysicalMemory pm(1024);
         
-        int id1 = pm.allocate_worst_fit(100);
+        BlockHandle id1 = pm.allocate_worst_fit(100);
         assert(id1 >= 0);
         assert(pm.used_memory() == 100);
         
-        int id2 = pm.allocate_worst_fit(200);
+        BlockHandle id2 = pm.allocate_worst_fit(200);
         assert(id2 >= 0);
         assert(pm.used_memory() == 300);
         
@@ -126,16 +140,16 @@ private:
         PhysicalMemory pm(1024);
         
         std::cout << "  [STEP 1] Allocate 100 bytes\n";
-        int id1 = pm.allocate_first_fit(100);
+        BlockHandle id1 = pm.allocate_first_fit(100);
         std::cout << "  [RESULT]  id1 = " << id1 << "\n";
         (void)id1;  // Kept allocated for testing
         
         std::cout << "  [STEP 2] Allocate 200 bytes\n";
-        int id2 = pm.allocate_first_fit(200);
+        BlockHandle id2 = pm.allocate_first_fit(200);
         std::cout << "  [RESULT]  id2 = " << id2 << "\n";
         
         std::cout << "  [STEP 3] Allocate 150 bytes\n";
-        int id3 = pm.allocate_first_fit(150);
+        BlockHandle id3 = pm.allocate_first_fit(150);
         std::cout << "  [RESULT]  id3 = " << id3 << "\n";
         (void)id3;  // Kept allocated for testing
         
@@ -154,7 +168,7 @@ private:
         assert(pm.free_memory() == 774);
         
         std::cout << "  [STEP 5] Allocate 50 bytes (should fit in freed 200-byte hole)\n";
-        int id4 = pm.allocate_first_fit(50);
+        BlockHandle id4 = pm.allocate_first_fit(50);
         std::cout << "  [RESULT]  id4 = " << id4 << " (should be valid)\n";
         assert(id4 >= 0);
         
@@ -170,12 +184,12 @@ private:
         PhysicalMemory pm(1024);
         
         // Create fragmentation
-        int id1 = pm.allocate_first_fit(100);
+        BlockHandle id1 = pm.allocate_first_fit(100);
         (void)id1;  // Kept allocated
-        int id2 = pm.allocate_first_fit(100);
-        int id3 = pm.allocate_first_fit(100);
+        BlockHandle id2 = pm.allocate_first_fit(100);
+        BlockHandle id3 = pm.allocate_first_fit(100);
         (void)id3;  // Kept allocated
-        int id4 = pm.allocate_first_fit(100);
+        BlockHandle id4 = pm.allocate_first_fit(100);
         
         pm.free_block(id2);
         pm.free_block(id4);
@@ -190,8 +204,8 @@ private:
         std::cout << "Testing memory metrics... ";
         PhysicalMemory pm(2048);
         
-        int id1 = pm.allocate_first_fit(512);
-        int id2 = pm.allocate_first_fit(256);
+        BlockHandle id1 = pm.allocate_first_fit(512);
+        BlockHandle id2 = pm.allocate_first_fit(256);
         (void)id2;  // Kept allocated
         
         assert(pm.total_memory() == 2048);
@@ -202,6 +216,12 @@ private:
         pm.free_block(id1);
         assert(pm.used_memory() == 256);
         assert(pm.free_memory() == 1792);
+        assert(pm.live_allocations() == 1);
+
+        // Holes of 512 and 1280 bytes: 1 - 1280/1792
+        double expected = 1.0 - 1280.0 / 1792.0;
+        assert(pm.external_fragmentation() > expected - 1e-9);
+        assert(pm.external_fragmentation() < expected + 1e-9);
         
         std::cout << "PASSED\n";
     }
@@ -210,14 +230,29 @@ private:
         std::cout << "Testing allocation failure... ";
         PhysicalMemory pm(256);
         
-        int id1 = pm.allocate_first_fit(512);  // Should fail - too large
+        BlockHandle id1 = pm.allocate_first_fit(512);  // Should fail - too large
         assert(id1 == -1);
         
-        int id2 = pm.allocate_first_fit(200);
+        BlockHandle id2 = pm.allocate_first_fit(200);
         assert(id2 >= 0);
         
-        int id3 = pm.allocate_first_fit(100);  // Should fail - not enough space
+        BlockHandle id3 = pm.allocate_first_fit(100);  // Should fail - not enough space
         assert(id3 == -1);
+
+        // Zero-size requests fail under every strategy
+        assert(pm.allocate(0) == -1);
+        assert(pm.allocate_best_fit(0) == -1);
+        assert(pm.allocate_worst_fit(0) == -1);
+        assert(pm.allocate_next_fit(0) == -1);
+        assert(pm.live_allocations() == 1);
+        assert(pm.check_invariants());
+
+        // An empty memory is consistent and allocates nothing
+        PhysicalMemory empty(0, AllocationStrategy::NEXT_FIT);
+        assert(empty.check_invariants());
+        assert(empty.allocate(1) == -1);
+        assert(empty.allocate(0) == -1);
+        assert(empty.largest_free_block() == 0);
         
         std::cout << "PASSED\n";
     }
@@ -226,9 +261,9 @@ private:
         std::cout << "Testing multiple allocations... ";
         PhysicalMemory pm(4096);
         
-        std::vector<int> ids;
+        std::vector<BlockHandle> ids;
         for (int i = 0; i < 10; ++i) {
-            int id = pm.allocate_first_fit(100);
+            BlockHandle id = pm.allocate_first_fit(100);
             assert(id >= 0);
             ids.push_back(id);
         }
@@ -249,7 +284,7 @@ private:
         std::cout << "Testing free with invalid ID... ";
         PhysicalMemory pm(1024);
         
-        int id1 = pm.allocate_first_fit(100);
+        BlockHandle id1 = pm.allocate_first_fit(100);
         pm.free_block(id1);
         
         // Freeing same block again should be safe (no-op)
@@ -265,9 +300,9 @@ private:
         std::cout << "Testing block coalescing... ";
         PhysicalMemory pm(1024);
         
-        int id1 = pm.allocate_first_fit(100);
-        int id2 = pm.allocate_first_fit(100);
-        int id3 = pm.allocate_first_fit(100);
+        BlockHandle id1 = pm.allocate_first_fit(100);
+        BlockHandle id2 = pm.allocate_first_fit(100);
+        BlockHandle id3 = pm.allocate_first_fit(100);
         (void)id3;  // Kept allocated
         
         // Free adjacent blocks
@@ -280,6 +315,708 @@ private:
         
         std::cout << "PASSED\n";
     }
+
+    static void test_block_handles_survive_merges() {
+        std::cout << "Testing block handles across splits and merges... ";
+        PhysicalMemory pm(1024);
+
+        BlockHandle id1 = pm.allocate_first_fit(100);
+        BlockHandle id2 = pm.allocate_first_fit(100);
+        BlockHandle id3 = pm.allocate_first_fit(100);
+        BlockHandle id4 = pm.allocate_first_fit(100);
+
+        // Free both neighbours of id3 so they merge around it
+        pm.free_block(id2);
+        pm.free_block(id4);
+        assert(pm.block_start(id3) == 200);
+
+        // Split the merged hole in front of id3 again
+        BlockHandle id5 = pm.allocate_first_fit(50);
+        assert(pm.block_start(id5) == 100);
+        assert(pm.block_start(id3) == 200);
+
+        pm.free_block(id3);
+        assert(pm.block_start(id3) == static_cast<size_t>(-1));
+        assert(pm.block_start(id1) == 0);
+        assert(pm.used_memory() == 150);
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_next_fit_allocation() {
+        std::cout << "Testing next-fit allocation... ";
+        PhysicalMemory pm(1000, AllocationStrategy::NEXT_FIT);
+        assert(std::string(pm.allocator_name()) == "Next Fit");
+
+        BlockHandle id1 = pm.allocate(100);
+        BlockHandle id2 = pm.allocate(100);
+        BlockHandle id3 = pm.allocate(100);
+        (void)id3;
+
+        // First fit would reuse the hole at 0; next fit keeps going forward
+        pm.free_block(id1);
+        BlockHandle id4 = pm.allocate(50);
+        assert(pm.block_start(id4) == 300);
+
+        // The rover sits on the tail hole; freeing id4 merges that hole
+        // away, and the rover must move to the merged block at 300
+        pm.free_block(id4);
+        BlockHandle id5 = pm.allocate(50);
+        assert(pm.block_start(id5) == 300);
+
+        // Wrap around to the front once nothing past the rover fits
+        BlockHandle id6 = pm.allocate(650);
+        assert(pm.block_start(id6) == 350);
+        BlockHandle id7 = pm.allocate(80);
+        assert(pm.block_start(id7) == 0);
+
+        pm.free_block(id2);
+        assert(pm.used_memory() == 100 + 50 + 650 + 80);
+
+        std::cout << "PASSED\n";
+    }
+
+    // Reference model: the original linear scan over every block
+    struct ReferenceHeap {
+        std::vector<MemoryBlock> blocks;
+        size_t rover = 0;  // next fit: index of the block to resume from
+
+        explicit ReferenceHeap(size_t total) {
+            blocks.push_back({0, total, true, -1});
+        }
+
+        size_t find(AllocationStrategy strategy, size_t size) const {
+            size_t pick = blocks.size();
+            if (strategy == AllocationStrategy::NEXT_FIT) {
+                for (size_t n = 0; n < blocks.size(); ++n) {
+                    size_t i = (rover + n) % blocks.size();
+                    if (blocks[i].free && blocks[i].size >= size) return i;
+                }
+                return pick;
+            }
+            for (size_t i = 0; i < blocks.size(); ++i) {
+                if (!blocks[i].free || blocks[i].size < size) continue;
+                if (pick == blocks.size()) {
+                    pick = i;
+                    if (strategy == AllocationStrategy::FIRST_FIT) break;
+                } else if (strategy == AllocationStrategy::BEST_FIT && blocks[i].size < blocks[pick].size) {
+                    pick = i;
+                } else if (strategy == AllocationStrategy::WORST_FIT && blocks[i].size > blocks[pick].size) {
+                    pick = i;
+                }
+            }
+            return pick;
+        }
+
+        // Returns the start address used, or -1
+        size_t allocate(AllocationStrategy strategy, size_t size, BlockHandle id) {
+            size_t i = find(strategy, size);
+            if (i == blocks.size()) return static_cast<size_t>(-1);
+            size_t start = blocks[i].start;
+            if (blocks[i].size == size) {
+                blocks[i].free = false;
+                blocks[i].id = id;
+            } else {
+                blocks[i].start += size;
+                blocks[i].size -= size;
+                blocks.insert(blocks.begin() + i, MemoryBlock{start, size, false, id});
+                if (rover >= i) ++rover;
+            }
+            if (strategy == AllocationStrategy::NEXT_FIT) {
+                rover = (i + 1) % blocks.size();
+            }
+            return start;
+        }
+
+        // Merged-away blocks hand the rover to the block that absorbed them
+        void erase(size_t j) {
+            blocks.erase(blocks.begin() + j);
+            if (rover >= j) --rover;
+        }
+
+        size_t largest_free() const {
+            size_t largest = 0;
+            for (const auto& block : blocks) {
+                if (block.free && block.size > largest) largest = block.size;
+            }
+            return largest;
+        }
+
+        void free(BlockHandle id) {
+            for (size_t i = 0; i < blocks.size(); ++i) {
+                if (blocks[i].free || blocks[i].id != id) continue;
+                blocks[i].free = true;
+                if (i + 1 < blocks.size() && blocks[i + 1].free) {
+                    blocks[i].size += blocks[i + 1].size;
+                    erase(i + 1);
+                }
+                if (i > 0 && blocks[i - 1].free) {
+                    blocks[i - 1].size += blocks[i].size;
+                    erase(i);
+                }
+                return;
+            }
+        }
+    };
+
+    static void test_placement_matches_linear_scan() {
+        std::cout << "Testing placement matches linear scan... ";
+        const AllocationStrategy strategies[] = {
+            AllocationStrategy::FIRST_FIT,
+            AllocationStrategy::BEST_FIT,
+            AllocationStrategy::WORST_FIT,
+            AllocationStrategy::NEXT_FIT
+        };
+
+        for (AllocationStrategy strategy : strategies) {
+            std::mt19937 rng(42);
+            PhysicalMemory pm(1 << 16, strategy);
+            ReferenceHeap ref(1 << 16);
+            std::vector<BlockHandle> live;
+
+            for (int op = 0; op < 5000; ++op) {
+                if (live.empty() || rng() % 3 != 0) {
+                    // Mix of exact-tier and power-of-two sized requests
+                    size_t size = (rng() % 2) ? 1 + rng() % 63 : 1 + rng() % 2048;
+                    BlockHandle id = pm.allocate(size);
+                    size_t expected = ref.allocate(strategy, size, id);
+                    if (expected == static_cast<size_t>(-1)) {
+                        assert(id == -1);
+                    } else {
+                        assert(id >= 0);
+                        assert(pm.block_start(id) == expected);
+                        live.push_back(id);
+                    }
+                } else {
+                    size_t victim = rng() % live.size();
+                    pm.free_block(live[victim]);
+                    ref.free(live[victim]);
+                    live[victim] = live.back();
+                    live.pop_back();
+                }
+                assert(pm.largest_free_block() == ref.largest_free());
+                if (op % 64 == 0) {
+                    assert(pm.check_invariants());
+                }
+            }
+            assert(pm.check_invariants());
+        }
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_slot_map_handles() {
+        std::cout << "Testing slot map handles... ";
+        SlotMap<int> map;
+
+        BlockHandle a = map.insert(10);
+        BlockHandle b = map.insert(20);
+        assert(a == 1 && b == 2);  // fresh slots count up from 1
+        assert(map.size() == 2);
+        assert(*map.find(b) == 20);
+
+        // Erasing bumps the generation, so the old handle goes stale
+        assert(map.erase(a));
+        assert(!map.erase(a));
+        BlockHandle c = map.insert(30);
+        assert(handle_index(c) == handle_index(a));
+        assert(handle_generation(c) == handle_generation(a) + 1);
+        assert(c != a && c > 0);
+        assert(map.find(a) == nullptr);
+        assert(*map.find(c) == 30);
+
+        // Unknown and invalid handles never match
+        assert(map.find(kInvalidHandle) == nullptr);
+        assert(map.find(0) == nullptr);
+        assert(map.find(999) == nullptr);
+
+        int sum = 0;
+        map.for_each([&sum](BlockHandle, int value) { sum += value; });
+        assert(sum == 50);
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_stale_handle_after_reuse() {
+        std::cout << "Testing stale handle after slot reuse... ";
+        PhysicalMemory pm(1024);
+
+        BlockHandle old_id = pm.allocate(100);
+        pm.free_block(old_id);
+        BlockHandle new_id = pm.allocate(200);
+        assert(new_id != old_id);
+
+        // Freeing through the stale handle must not touch the new block
+        pm.free_block(old_id);
+        assert(pm.live_allocations() == 1);
+        assert(pm.used_memory() == 200);
+        assert(pm.block_start(old_id) == static_cast<size_t>(-1));
+        assert(pm.check_invariants());
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_compaction_relocation_map() {
+        std::cout << "Testing compaction relocation map... ";
+        PhysicalMemory pm(1024);
+
+        BlockHandle a = pm.allocate(256);
+        BlockHandle b = pm.allocate(256);
+        BlockHandle c = pm.allocate(256);
+        BlockHandle d = pm.allocate(256);
+        pm.free_block(a);
+        pm.free_block(c);
+
+        // 512 bytes free, but in two 256-byte holes
+        assert(pm.free_memory() == 512);
+        assert(pm.allocate(512) == -1);
+        assert(pm.compaction_stats().passes == 0);
+
+        CompactionResult result = pm.compact();
+        assert(result.bytes_moved == 512);
+        assert(result.relocations.size() == 2);
+        assert(result.relocations.at(256) == 0);
+        assert(result.relocations.at(768) == 256);
+
+        // Handles survive the move
+        assert(pm.block_start(b) == 0);
+        assert(pm.block_start(d) == 256);
+        assert(pm.largest_free_block() == 512);
+        assert(pm.external_fragmentation() == 0.0);
+        assert(pm.check_invariants());
+
+        BlockHandle e = pm.allocate(512);
+        assert(pm.block_start(e) == 512);
+
+        // Nothing left to move
+        pm.free_block(e);
+        assert(pm.compact().bytes_moved == 0);
+        assert(pm.compaction_stats().passes == 2);
+        assert(pm.compaction_stats().bytes_moved == 512);
+        assert(pm.check_invariants());
+
+        // A record that once held an aligned block is reused for a plain
+        // one, which must not keep the old alignment when compacted
+        PhysicalMemory reused(256);
+        BlockHandle first = reused.allocate(64);
+        reused.free_block(reused.allocate_aligned(16, 64));
+        BlockHandle second = reused.allocate(100);
+        BlockHandle third = reused.allocate(92);
+        assert(reused.block_start(third) == 164);
+        reused.free_block(first);
+
+        reused.compact();
+        assert(reused.block_start(second) == 0);
+        assert(reused.block_start(third) == 100);
+        assert(reused.largest_free_block() == 64);
+        assert(reused.check_invariants());
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_on_demand_compaction() {
+        std::cout << "Testing on-demand compaction... ";
+        PhysicalMemory pm(1024, AllocationStrategy::NEXT_FIT);
+        pm.set_compaction_policy(CompactionPolicy::ON_DEMAND);
+
+        std::vector<BlockHandle> ids;
+        for (int i = 0; i < 8; ++i) {
+            ids.push_back(pm.allocate(128));
+        }
+        for (int i = 0; i < 8; i += 2) {
+            pm.free_block(ids[i]);
+        }
+
+        // Fits only after compacting; the relocations stay available
+        BlockHandle big = pm.allocate(512);
+        assert(big != -1);
+        assert(pm.block_start(big) == 512);
+        assert(pm.compaction_stats().passes == 1);
+        assert(pm.compaction_stats().failures_avoided == 1);
+        assert(pm.last_compaction().bytes_moved == 4 * 128);
+        for (int i = 1; i < 8; i += 2) {
+            assert(pm.block_start(ids[i]) == static_cast<size_t>(i / 2) * 128);
+        }
+        assert(pm.check_invariants());
+
+        // Requests larger than free memory fail without compacting
+        assert(pm.allocate(1024) == -1);
+        assert(pm.compaction_stats().passes == 1);
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_background_compaction() {
+        std::cout << "Testing background compaction... ";
+        PhysicalMemory pm(64 * 1024, AllocationStrategy::BEST_FIT);
+        pm.set_compaction_policy(CompactionPolicy::BACKGROUND, 0.4);
+        assert(pm.compaction_policy() == CompactionPolicy::BACKGROUND);
+
+        std::mt19937 rng(5);
+        std::vector<BlockHandle> live;
+        for (int op = 0; op < 5000; ++op) {
+            if (live.empty() || rng() % 2 == 0) {
+                BlockHandle id = pm.allocate(16 + rng() % 1024);
+                if (id != -1) {
+                    live.push_back(id);
+                }
+            } else {
+                size_t victim = rng() % live.size();
+                pm.free_block(live[victim]);
+                live[victim] = live.back();
+                live.pop_back();
+                // A free never leaves fragmentation above the threshold
+                assert(pm.external_fragmentation() <= 0.4);
+            }
+            if (op % 250 == 0) {
+                assert(pm.check_invariants());
+            }
+        }
+
+        const CompactionStats& stats = pm.compaction_stats();
+        assert(stats.passes > 0);
+        assert(stats.bytes_moved > 0);
+        assert(stats.blocks_moved > 0);
+        for (BlockHandle id : live) {
+            assert(pm.block_start(id) != static_cast<size_t>(-1));
+        }
+        assert(pm.check_invariants());
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_aligned_allocation() {
+        std::cout << "Testing aligned allocation... ";
+        PhysicalMemory pm(4096);
+
+        BlockHandle a = pm.allocate(100);
+        BlockHandle b = pm.allocate_aligned(256, 256);
+        assert(pm.block_start(b) == 256);
+        assert(pm.used_memory() == 356);
+
+        // The padding in front of b is a free block, not waste
+        BlockHandle c = pm.allocate(156);
+        assert(pm.block_start(c) == 100);
+        assert(pm.check_invariants());
+
+        // Invalid alignments are rejected
+        assert(pm.allocate_aligned(64, 0) == -1);
+        assert(pm.allocate_aligned(64, 48) == -1);
+        assert(pm.allocate_aligned(0, 64) == -1);
+
+        // A small hole that happens to start aligned is found by first fit
+        pm.free_block(a);
+        BlockHandle d = pm.allocate_aligned(64, 64);
+        assert(pm.block_start(d) == 0);
+        assert(pm.check_invariants());
+
+        // Every strategy honours the alignment and survives compaction
+        const AllocationStrategy strategies[] = {
+            AllocationStrategy::FIRST_FIT, AllocationStrategy::BEST_FIT,
+            AllocationStrategy::WORST_FIT, AllocationStrategy::NEXT_FIT
+        };
+        for (AllocationStrategy strategy : strategies) {
+            PhysicalMemory mem(64 * 1024, strategy);
+            std::mt19937 rng(17);
+            std::vector<std::pair<BlockHandle, size_t>> live;
+            for (int op = 0; op < 2000; ++op) {
+                if (live.empty() || rng() % 3 != 0) {
+                    size_t alignment = static_cast<size_t>(1) << (rng() % 10);
+                    BlockHandle id = mem.allocate_aligned(1 + rng() % 500, alignment);
+                    if (id != -1) {
+                        assert(mem.block_start(id) % alignment == 0);
+                        live.push_back({id, alignment});
+                    }
+                } else {
+                    size_t victim = rng() % live.size();
+                    mem.free_block(live[victim].first);
+                    live[victim] = live.back();
+                    live.pop_back();
+                }
+                if (op % 100 == 0) {
+                    assert(mem.check_invariants());
+                }
+            }
+
+            mem.compact();
+            assert(mem.check_invariants());
+            for (const auto& [id, alignment] : live) {
+                assert(mem.block_start(id) % alignment == 0);
+            }
+        }
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_compaction_of_aligned_blocks() {
+        std::cout << "Testing compaction of aligned blocks... ";
+
+        // Freeing x shifts everything down by 7. A (2-aligned) keeps a
+        // 1-byte gap and B (4-aligned) a 2-byte one; the second gap needs
+        // a new record while compaction still holds B.
+        PhysicalMemory small(256);
+        BlockHandle x = small.allocate(7);
+        small.allocate(1);
+        BlockHandle a = small.allocate_aligned(2, 2);
+        small.allocate(2);
+        BlockHandle b = small.allocate_aligned(4, 4);
+        BlockHandle c = small.allocate(1);
+        small.allocate(1);
+        assert(small.block_start(b) == 12);
+        small.free_block(x);
+
+        small.compact();
+        assert(small.block_start(a) == 2);
+        assert(small.block_start(b) == 8);
+        assert(small.block_start(c) == 12);
+        assert(small.check_invariants());
+
+        std::mt19937 rng(21);
+        PhysicalMemory pm(64 * 1024);
+        std::vector<std::pair<BlockHandle, std::size_t>> live;
+
+        // Random mixes of alignments, frees and compaction passes
+        for (int round = 0; round < 200; ++round) {
+            for (int i = 0; i < 20; ++i) {
+                std::size_t alignment = std::size_t(1) << (rng() % 9);
+                BlockHandle id = pm.allocate_aligned(1 + rng() % 200, alignment);
+                if (id != -1) {
+                    live.emplace_back(id, alignment);
+                }
+            }
+            for (std::size_t i = 0; i < live.size(); ++i) {
+                if (rng() % 2 == 0) {
+                    pm.free_block(live[i].first);
+                    live[i] = live.back();
+                    live.pop_back();
+                }
+            }
+
+            pm.compact();
+            assert(pm.check_invariants());
+            for (const auto& entry : live) {
+                assert(pm.block_start(entry.first) % entry.second == 0);
+            }
+        }
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_reallocate() {
+        std::cout << "Testing reallocate... ";
+        PhysicalMemory pm(1024);
+
+        BlockHandle a = pm.allocate(100);
+        BlockHandle b = pm.allocate(100);
+
+        // Shrinking splits off the tail as a free block
+        assert(pm.reallocate(a, 60));
+        assert(pm.used_memory() == 160);
+        BlockHandle c = pm.allocate(40);
+        assert(pm.block_start(c) == 60);
+        pm.free_block(c);
+
+        // Growing takes space from the free right neighbour
+        assert(pm.reallocate(a, 100));
+        assert(pm.block_start(a) == 0);
+        assert(pm.reallocate(b, 400));
+        assert(pm.block_start(b) == 100);
+        assert(pm.realloc_stats().in_place == 3);
+        assert(pm.check_invariants());
+
+        // No room next to a: it moves, keeping its handle
+        assert(pm.reallocate(a, 200));
+        assert(pm.block_start(a) == 500);
+        assert(pm.used_memory() == 600);
+        assert(pm.live_allocations() == 2);
+        assert(pm.realloc_stats().moved == 1);
+        assert(pm.check_invariants());
+
+        // Too large: fails and leaves the block alone
+        assert(!pm.reallocate(a, 2000));
+        assert(pm.block_start(a) == 500);
+        assert(pm.realloc_stats().failed == 1);
+        assert(!pm.reallocate(kInvalidHandle, 10));
+        assert(!pm.reallocate(a, 0));
+
+        // Growing exactly into the whole neighbour removes it
+        assert(pm.reallocate(a, 524));
+        assert(pm.free_memory() == 100);
+        assert(pm.check_invariants());
+
+        std::mt19937 rng(29);
+        PhysicalMemory mem(64 * 1024, AllocationStrategy::NEXT_FIT);
+        std::vector<BlockHandle> live;
+        for (int op = 0; op < 3000; ++op) {
+            unsigned kind = rng() % 3;
+            if (live.empty() || kind == 0) {
+                BlockHandle id = mem.allocate(1 + rng() % 800);
+                if (id != -1) {
+                    live.push_back(id);
+                }
+            } else if (kind == 1) {
+                mem.reallocate(live[rng() % live.size()], 1 + rng() % 1600);
+            } else {
+                size_t victim = rng() % live.size();
+                mem.free_block(live[victim]);
+                live[victim] = live.back();
+                live.pop_back();
+            }
+            if (op % 100 == 0) {
+                assert(mem.check_invariants());
+            }
+        }
+        const ReallocStats& stats = mem.realloc_stats();
+        assert(stats.in_place > 0 && stats.moved > 0);
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_batch_allocation() {
+        std::cout << "Testing batch allocation... ";
+
+        // On the same fragmented heap a batch lands where single calls would
+        for (AllocationStrategy strategy : {AllocationStrategy::FIRST_FIT,
+                                            AllocationStrategy::BEST_FIT,
+                                            AllocationStrategy::NEXT_FIT,
+                                            AllocationStrategy::WORST_FIT}) {
+            PhysicalMemory single(4096, strategy);
+            PhysicalMemory batched(4096, strategy);
+            for (PhysicalMemory* pm : {&single, &batched}) {
+                std::vector<BlockHandle> ids;
+                for (size_t size : {100, 50, 300, 20, 700, 40}) {
+                    ids.push_back(pm->allocate(size));
+                }
+                pm->free_block(ids[0]);
+                pm->free_block(ids[2]);
+                pm->free_block(ids[4]);
+            }
+
+            std::vector<size_t> sizes = {32, 32, 32, 32, 32, 32, 32, 32, 200, 200, 64, 5000};
+            std::vector<BlockHandle> out(sizes.size());
+            size_t allocated = batched.allocate_batch(sizes.data(), sizes.size(), out.data());
+            assert(allocated == sizes.size() - 1);
+            assert(out[11] == kInvalidHandle);
+
+            for (size_t i = 0; i < sizes.size(); ++i) {
+                BlockHandle id = single.allocate(sizes[i]);
+                if (out[i] != kInvalidHandle) {
+                    assert(batched.block_start(out[i]) == single.block_start(id));
+                }
+            }
+            assert(batched.used_memory() == single.used_memory());
+            assert(batched.check_invariants());
+
+            batched.free_batch(out.data(), out.size());
+            assert(batched.used_memory() == 110);
+            assert(batched.check_invariants());
+        }
+
+        // Worst fit moves to the next-largest hole as soon as single calls
+        // would, including on ties, which go to the lower address
+        for (size_t run : {3, 5, 7}) {
+            PhysicalMemory single(1000, AllocationStrategy::WORST_FIT);
+            PhysicalMemory batched(1000, AllocationStrategy::WORST_FIT);
+            for (PhysicalMemory* pm : {&single, &batched}) {
+                BlockHandle first = pm->allocate(300);
+                pm->allocate(100);
+                BlockHandle second = pm->allocate(250);
+                pm->allocate(350);
+                pm->free_block(first);
+                pm->free_block(second);
+            }
+
+            std::vector<size_t> sizes(run, 50);
+            sizes[0] = sizes[1] = sizes[2] = 100;
+            std::vector<BlockHandle> out(sizes.size());
+            assert(batched.allocate_batch(sizes.data(), sizes.size(), out.data()) == run);
+            for (size_t i = 0; i < sizes.size(); ++i) {
+                BlockHandle id = single.allocate(sizes[i]);
+                assert(batched.block_start(out[i]) == single.block_start(id));
+            }
+            assert(batched.largest_free_block() == single.largest_free_block());
+            assert(batched.check_invariants());
+        }
+        {
+            PhysicalMemory single(1000, AllocationStrategy::WORST_FIT);
+            PhysicalMemory batched(1000, AllocationStrategy::WORST_FIT);
+            std::vector<size_t> sizes(3, 100);
+            std::vector<BlockHandle> out(sizes.size());
+            for (PhysicalMemory* pm : {&single, &batched}) {
+                BlockHandle first = pm->allocate(300);
+                pm->allocate(100);
+                BlockHandle second = pm->allocate(250);
+                pm->allocate(350);
+                pm->free_block(first);
+                pm->free_block(second);
+            }
+            batched.allocate_batch(sizes.data(), sizes.size(), out.data());
+            assert(batched.block_start(out[0]) == 0);
+            assert(batched.block_start(out[1]) == 400);
+            assert(batched.block_start(out[2]) == 100);
+            assert(batched.largest_free_block() == 150);
+        }
+
+        // Random batches on a random worst fit heap match single calls
+        std::mt19937 rng(41);
+        for (int round = 0; round < 50; ++round) {
+            PhysicalMemory single(8192, AllocationStrategy::WORST_FIT);
+            PhysicalMemory batched(8192, AllocationStrategy::WORST_FIT);
+            std::vector<size_t> layout;
+            for (int i = 0; i < 20; ++i) {
+                layout.push_back(16 + rng() % 400);
+            }
+            for (PhysicalMemory* pm : {&single, &batched}) {
+                std::vector<BlockHandle> ids;
+                for (size_t size : layout) {
+                    ids.push_back(pm->allocate(size));
+                }
+                for (size_t i = 0; i < ids.size(); i += 2) {
+                    pm->free_block(ids[i]);
+                }
+            }
+            std::vector<size_t> sizes;
+            while (sizes.size() < 40) {
+                size_t size = 8 + rng() % 120;
+                for (size_t n = 1 + rng() % 8; n > 0; --n) {
+                    sizes.push_back(size);
+                }
+            }
+            std::vector<BlockHandle> out(sizes.size());
+            batched.allocate_batch(sizes.data(), sizes.size(), out.data());
+            for (size_t i = 0; i < sizes.size(); ++i) {
+                BlockHandle id = single.allocate(sizes[i]);
+                assert((out[i] == kInvalidHandle) == (id == kInvalidHandle));
+                if (id != kInvalidHandle) {
+                    assert(batched.block_start(out[i]) == single.block_start(id));
+                }
+            }
+            assert(batched.largest_free_block() == single.largest_free_block());
+            assert(batched.check_invariants());
+        }
+
+        // Zero sizes fail inside a batch too
+        PhysicalMemory zeros(256);
+        std::vector<size_t> with_zero = {0, 0, 16, 0};
+        std::vector<BlockHandle> zero_out(with_zero.size());
+        assert(zeros.allocate_batch(with_zero.data(), with_zero.size(), zero_out.data()) == 1);
+        assert(zero_out[0] == kInvalidHandle && zero_out[3] == kInvalidHandle);
+        assert(zeros.check_invariants());
+
+        // A run larger than memory fills it; the rest of the run fails
+        PhysicalMemory pm(1000, AllocationStrategy::WORST_FIT);
+        std::vector<size_t> sizes(12, 100);
+        std::vector<BlockHandle> out(sizes.size());
+        assert(pm.allocate_batch(sizes.data(), sizes.size(), out.data()) == 10);
+        assert(pm.free_memory() == 0);
+        assert(out[10] == kInvalidHandle);
+        assert(pm.check_invariants());
+        pm.free_batch(out.data(), out.size());
+        assert(pm.live_allocations() == 0);
+        assert(pm.largest_free_block() == 1000);
+
+        std::cout << "PASSED\n";
+    }
 };
 
 int main() {
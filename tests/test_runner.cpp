@@ -5,6 +5,9 @@
 // Test runner declarations
 int run_physical_memory_tests();
 int run_buddy_allocator_tests();
+int run_per_cpu_page_cache_tests();
+int run_tlsf_allocator_tests();
+int run_slab_allocator_tests();
 int run_cache_tests();
 int run_virtual_memory_tests();
 int run_page_table_tests();
@@ -47,6 +50,9 @@ int run_all_tests() {
     std::cout << "\nTo run individual test suites, compile and run:\n";
     std::cout << "  - test_physical_memory\n";
     std::cout << "  - test_buddy_allocator\n";
+    std::cout << "  - test_per_cpu_page_cache\n";
+    std::cout << "  - test_tlsf_allocator\n";
+    std::cout << "  - test_slab_allocator\n";
     std::cout << "  - test_cache\n";
     std::cout << "  - test_virtual_memory\n";
     std::cout << "  - test_page_table\n";
@@ -61,6 +67,9 @@ void print_usage(const char* program_name) {
     std::cout << "  --all                Run all test suites\n";
     std::cout << "  --physical-memory    Run PhysicalMemory tests\n";
     std::cout << "  --buddy              Run BuddyAllocator tests\n";
+    std::cout << "  --per-cpu-cache      Run PerCpuPageCache tests\n";
+    std::cout << "  --tlsf               Run TlsfAllocator tests\n";
+    std::cout << "  --slab               Run SlabAllocator tests\n";
     std::cout << "  --cache              Run DirectMappedCache tests\n";
     std::cout << "  --virtual-memory     Run VirtualMemoryManager tests\n";
     std::cout << "  --page-table         Run PageTable tests\n";
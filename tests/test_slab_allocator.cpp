@@ -0,0 +1,307 @@
+#include "../include/slab/SlabAllocator.h"
+#include "../include/buddy/BuddyAllocator.h"
+#include <iostream>
+#include <cassert>
+#include <vector>
+#include <set>
+
+class SlabAllocatorTests {
+public:
+    static void run_all_tests() {
+        std::cout << "\n=== Running SlabAllocator Tests ===\n";
+
+        test_initialization();
+        test_same_size_objects_share_slab();
+        test_slab_growth();
+        test_free_and_reuse();
+        test_empty_slab_reclaim();
+        test_large_allocation_bypass();
+        test_internal_fragmentation_vs_buddy();
+        test_allocation_failure();
+        test_random_trace_invariants();
+        test_aligned_allocation();
+        test_reallocate();
+
+        std::cout << "=== All SlabAllocator Tests Passed! ===\n\n";
+    }
+
+private:
+    static void test_initialization() {
+        std::cout << "Testing initialization... ";
+        SlabAllocator slab(65536, 4096);
+
+        assert(slab.total_memory() == 65536);
+        assert(slab.used_memory() == 0);
+        assert(slab.free_memory() == 65536);
+        assert(slab.live_allocations() == 0);
+        assert(slab.cache_stats().empty());
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_same_size_objects_share_slab() {
+        std::cout << "Testing same-size objects share a slab... ";
+        std::cout << "\n  [DEBUG] 64 KiB memory, 4 KiB slabs\n";
+        SlabAllocator slab(65536, 4096);
+
+        BlockHandle id1 = slab.allocate(100);
+        BlockHandle id2 = slab.allocate(100);
+        std::cout << "  [RESULT]  id1 at 0x" << std::hex << slab.block_start(id1)
+                  << ", id2 at 0x" << slab.block_start(id2) << std::dec << "\n";
+
+        // 100 bytes round to 104-byte slots packed back to back
+        assert(slab.block_start(id2) == slab.block_start(id1) + 104);
+
+        std::cout << "  [EXPECTED] one slab taken from the buddy allocator\n";
+        std::cout << "  [ACTUAL]   used_memory = " << slab.used_memory() << "\n";
+        assert(slab.used_memory() == 4096);
+
+        auto stats = slab.cache_stats();
+        assert(stats.size() == 1);
+        assert(stats[0].object_size == 104);
+        assert(stats[0].objects_per_slab == 4096 / 104);
+        assert(stats[0].active_objects == 2);
+        assert(stats[0].partial_slabs == 1);
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_slab_growth() {
+        std::cout << "Testing slab growth... ";
+        SlabAllocator slab(65536, 4096);
+
+        // 64-byte objects: 64 per slab, so 65 objects need a second slab
+        std::set<size_t> addrs;
+        for (int i = 0; i < 65; ++i) {
+            BlockHandle id = slab.allocate(64);
+            assert(id >= 0);
+            assert(addrs.insert(slab.block_start(id)).second);
+        }
+
+        auto stats = slab.cache_stats();
+        assert(stats[0].slabs == 2);
+        assert(stats[0].full_slabs == 1);
+        assert(stats[0].partial_slabs == 1);
+        assert(slab.used_memory() == 8192);
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_free_and_reuse() {
+        std::cout << "Testing free and object reuse... ";
+        SlabAllocator slab(65536, 4096);
+
+        BlockHandle id1 = slab.allocate(32);
+        BlockHandle id2 = slab.allocate(32);
+        (void)id2;
+        size_t addr1 = slab.block_start(id1);
+
+        slab.free_block(id1);
+        assert(slab.live_allocations() == 1);
+
+        // The freed slot is the top of the slab's free stack
+        BlockHandle id3 = slab.allocate(32);
+        assert(slab.block_start(id3) == addr1);
+
+        // Double free and unknown ids are no-ops
+        slab.free_block(id1);
+        slab.free_block(9999);
+        assert(slab.live_allocations() == 2);
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_empty_slab_reclaim() {
+        std::cout << "Testing empty slab reclaim... ";
+        SlabAllocator slab(65536, 4096);
+
+        std::vector<BlockHandle> ids;
+        for (int i = 0; i < 64 * 3; ++i) {
+            ids.push_back(slab.allocate(64));
+        }
+        assert(slab.used_memory() == 3 * 4096);
+
+        for (BlockHandle id : ids) {
+            slab.free_block(id);
+        }
+
+        // One empty slab is kept in reserve, the others go back to the buddy
+        auto stats = slab.cache_stats();
+        assert(stats[0].empty_slabs == 1);
+        assert(slab.used_memory() == 4096);
+
+        size_t released = slab.reclaim();
+        assert(released == 4096);
+        assert(slab.used_memory() == 0);
+        assert(slab.largest_free_block() == 65536);
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_large_allocation_bypass() {
+        std::cout << "Testing large allocations bypass the caches... ";
+        SlabAllocator slab(65536, 4096);
+
+        BlockHandle id = slab.allocate(3000);
+        assert(id >= 0);
+        assert(slab.cache_stats().empty());
+        assert(slab.used_memory() == 4096);  // buddy rounds to 4 KiB
+
+        slab.free_block(id);
+        assert(slab.used_memory() == 0);
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_internal_fragmentation_vs_buddy() {
+        std::cout << "Testing internal fragmentation vs buddy... ";
+        SlabAllocator slab(1 << 20, 4096);
+        BuddyAllocator buddy(1 << 20);
+
+        const size_t sizes[] = {24, 72, 100, 200};
+        for (int i = 0; i < 400; ++i) {
+            size_t size = sizes[i % 4];
+            assert(slab.allocate(size) >= 0);
+            assert(buddy.allocate(size) >= 0);
+        }
+
+        std::cout << "\n  [RESULT]  buddy internal fragmentation = "
+                  << buddy.internal_fragmentation() * 100.0 << "%\n";
+        std::cout << "  [RESULT]  slab internal fragmentation  = "
+                  << slab.internal_fragmentation() * 100.0 << "%\n";
+        assert(slab.internal_fragmentation() < buddy.internal_fragmentation() / 2);
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_allocation_failure() {
+        std::cout << "Testing allocation failure... ";
+        SlabAllocator slab(8192, 4096);
+
+        assert(slab.allocate(0) == -1);
+        assert(slab.allocate(16384) == -1);
+
+        // Two slabs exhaust the buddy allocator
+        for (int i = 0; i < 2 * 64; ++i) {
+            assert(slab.allocate(64) >= 0);
+        }
+        assert(slab.allocate(64) == -1);
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_random_trace_invariants() {
+        std::cout << "Testing invariants over a random trace... ";
+        SlabAllocator slab(1 << 20, 4096);
+
+        std::vector<BlockHandle> live;
+        unsigned seed = 11;
+        for (int op = 0; op < 5000; ++op) {
+            seed = seed * 1103515245u + 12345u;
+            if (live.empty() || (seed >> 16) % 3 != 0) {
+                // Mostly small objects, some large enough to bypass the caches
+                size_t size = (seed >> 8) % 8 == 0 ? 600 + (seed >> 4) % 3000
+                                                   : 1 + (seed >> 4) % 300;
+                BlockHandle id = slab.allocate(size);
+                if (id != -1) {
+                    live.push_back(id);
+                }
+            } else {
+                size_t victim = (seed >> 4) % live.size();
+                slab.free_block(live[victim]);
+                live[victim] = live.back();
+                live.pop_back();
+            }
+            if (op % 50 == 0) {
+                assert(slab.check_invariants());
+            }
+        }
+
+        for (BlockHandle id : live) {
+            slab.free_block(id);
+        }
+        slab.reclaim();
+        assert(slab.check_invariants());
+        assert(slab.used_memory() == 0);
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_aligned_allocation() {
+        std::cout << "Testing aligned allocation... ";
+        SlabAllocator slab(65536, 4096);
+
+        // Cache-line alignment uses the 64-byte cache, so every object lines up
+        std::vector<BlockHandle> ids;
+        for (int i = 0; i < 10; ++i) {
+            BlockHandle id = slab.allocate_aligned(40, 64);
+            assert(slab.block_start(id) % 64 == 0);
+            ids.push_back(id);
+        }
+        assert(slab.cache_stats().size() == 1);
+        assert(slab.cache_stats()[0].object_size == 64);
+
+        // Page alignment falls through to an aligned buddy block
+        BlockHandle page = slab.allocate_aligned(100, 4096);
+        assert(slab.block_start(page) % 4096 == 0);
+        assert(slab.allocate_aligned(100, 12) == -1);
+        assert(slab.check_invariants());
+
+        for (BlockHandle id : ids) {
+            slab.free_block(id);
+        }
+        slab.free_block(page);
+        slab.reclaim();
+        assert(slab.used_memory() == 0);
+        assert(slab.check_invariants());
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_reallocate() {
+        std::cout << "Testing reallocate... ";
+        SlabAllocator slab(65536, 4096);
+
+        // Shrinking, or growing within the 64-byte slot, stays put
+        BlockHandle obj = slab.allocate(64);
+        size_t addr = slab.block_start(obj);
+        assert(slab.reallocate(obj, 20));
+        assert(slab.reallocate(obj, 64));
+        assert(slab.block_start(obj) == addr);
+        assert(slab.realloc_stats().in_place == 2);
+
+        // A bigger size moves to the 128-byte cache under the same handle
+        assert(slab.reallocate(obj, 100));
+        assert(slab.block_start(obj) != addr);
+        assert(slab.realloc_stats().moved == 1);
+        assert(slab.live_allocations() == 1);
+        assert(slab.check_invariants());
+
+        // Large blocks are resized by the buddy allocator
+        BlockHandle big = slab.allocate(2048);
+        size_t big_addr = slab.block_start(big);
+        assert(slab.reallocate(big, 1024));
+        assert(slab.block_start(big) == big_addr);
+        assert(slab.check_invariants());
+
+        assert(!slab.reallocate(big, 1 << 20));
+        assert(slab.realloc_stats().failed == 1);
+        assert(slab.check_invariants());
+
+        // A moved object keeps its alignment: 100 bytes at 64-byte
+        // alignment go to the 128-byte cache, not the 104-byte one
+        for (int i = 0; i < 3; ++i) {
+            BlockHandle line = slab.allocate_aligned(40, 64);
+            assert(slab.reallocate(line, 100));
+            assert(slab.block_start(line) % 64 == 0);
+        }
+        assert(slab.check_invariants());
+
+        std::cout << "PASSED\n";
+    }
+};
+
+int main() {
+    SlabAllocatorTests::run_all_tests();
+    return 0;
+}
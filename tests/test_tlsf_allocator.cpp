@@ -0,0 +1,371 @@
+#include "../include/tlsf/TlsfAllocator.h"
+#include <iostream>
+#include <cassert>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <utility>
+
+class TlsfAllocatorTests {
+public:
+    static void run_all_tests() {
+        std::cout << "\n=== Running TlsfAllocator Tests ===\n";
+
+        test_initialization();
+        test_simple_allocation();
+        test_allocation_and_free();
+        test_coalescing();
+        test_whole_memory_allocation();
+        test_allocation_failure();
+        test_fragmentation_metrics();
+        test_random_trace_consistency();
+        test_aligned_allocation();
+        test_fresh_records_on_free_lists();
+        test_reallocate();
+
+        std::cout << "=== All TlsfAllocator Tests Passed! ===\n\n";
+    }
+
+private:
+    static void test_initialization() {
+        std::cout << "Testing initialization... ";
+        TlsfAllocator tlsf(4096);
+
+        assert(tlsf.total_memory() == 4096);
+        assert(tlsf.used_memory() == 0);
+        assert(tlsf.free_memory() == 4096);
+        assert(tlsf.largest_free_block() == 4096);
+        assert(tlsf.live_allocations() == 0);
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_simple_allocation() {
+        std::cout << "Testing simple allocation... ";
+        std::cout << "\n  [DEBUG] Creating TlsfAllocator with size 4096 bytes\n";
+        TlsfAllocator tlsf(4096);
+
+        std::cout << "  [STEP 1] Allocating 100 bytes\n";
+        BlockHandle id1 = tlsf.allocate(100);
+        std::cout << "  [ACTUAL]   id1 = " << id1 << "\n";
+        assert(id1 >= 0);
+        assert(tlsf.block_start(id1) == 0);
+
+        std::cout << "  [STEP 2] Allocating 200 bytes\n";
+        BlockHandle id2 = tlsf.allocate(200);
+        std::cout << "  [ACTUAL]   id2 = " << id2 << "\n";
+        assert(id2 >= 0 && id2 != id1);
+        assert(tlsf.block_start(id2) == 100);
+
+        std::cout << "  [EXPECTED] used_memory = 300 (no rounding)\n";
+        std::cout << "  [ACTUAL]   used_memory = " << tlsf.used_memory() << "\n";
+        assert(tlsf.used_memory() == 300);
+        assert(tlsf.largest_free_block() == 4096 - 300);
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_allocation_and_free() {
+        std::cout << "Testing allocation and free... ";
+        TlsfAllocator tlsf(2048);
+
+        BlockHandle id1 = tlsf.allocate(256);
+        BlockHandle id2 = tlsf.allocate(256);
+        assert(tlsf.live_allocations() == 2);
+
+        tlsf.free_block(id1);
+        assert(tlsf.used_memory() == 256);
+        assert(tlsf.block_start(id1) == static_cast<size_t>(-1));
+
+        // Double free and unknown ids are no-ops
+        tlsf.free_block(id1);
+        tlsf.free_block(9999);
+        assert(tlsf.live_allocations() == 1);
+
+        tlsf.free_block(id2);
+        assert(tlsf.free_memory() == 2048);
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_coalescing() {
+        std::cout << "Testing block coalescing... ";
+        TlsfAllocator tlsf(1024);
+
+        BlockHandle id1 = tlsf.allocate(100);
+        BlockHandle id2 = tlsf.allocate(100);
+        BlockHandle id3 = tlsf.allocate(100);
+
+        tlsf.free_block(id1);
+        tlsf.free_block(id3);
+        // Hole at the front plus the merged tail
+        assert(tlsf.largest_free_block() == 1024 - 200);
+
+        // Freeing the middle block merges both neighbours
+        tlsf.free_block(id2);
+        assert(tlsf.largest_free_block() == 1024);
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_whole_memory_allocation() {
+        std::cout << "Testing whole-memory allocation... ";
+        // Rounded-up search overshoots the only block; the fallback
+        // must still hand out the entire heap
+        TlsfAllocator tlsf(1000);
+        BlockHandle id = tlsf.allocate(1000);
+        assert(id >= 0);
+        assert(tlsf.free_memory() == 0);
+        assert(tlsf.largest_free_block() == 0);
+
+        tlsf.free_block(id);
+        assert(tlsf.largest_free_block() == 1000);
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_allocation_failure() {
+        std::cout << "Testing allocation failure... ";
+        TlsfAllocator tlsf(512);
+
+        assert(tlsf.allocate(0) == -1);
+        assert(tlsf.allocate(1024) == -1);
+
+        BlockHandle id1 = tlsf.allocate(400);
+        assert(id1 >= 0);
+        assert(tlsf.allocate(200) == -1);
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_fragmentation_metrics() {
+        std::cout << "Testing fragmentation metrics... ";
+        TlsfAllocator tlsf(1024);
+
+        std::vector<BlockHandle> ids;
+        for (int i = 0; i < 8; ++i) {
+            ids.push_back(tlsf.allocate(128));
+        }
+        assert(tlsf.external_fragmentation() == 0.0);
+
+        // Every other block free: 4 isolated holes of 128 bytes
+        for (size_t i = 0; i < ids.size(); i += 2) {
+            tlsf.free_block(ids[i]);
+        }
+        assert(tlsf.largest_free_block() == 128);
+        double expected = 1.0 - 128.0 / 512.0;
+        assert(tlsf.external_fragmentation() > expected - 1e-9);
+        assert(tlsf.external_fragmentation() < expected + 1e-9);
+
+        // Holes of 1000 and 1010 bytes share a class; the estimate is one
+        // of them, so within 1/16 of the true largest
+        TlsfAllocator shared(4096);
+        BlockHandle a = shared.allocate(1000);
+        shared.allocate(8);
+        BlockHandle b = shared.allocate(1010);
+        shared.allocate(4096 - 2018);
+        shared.free_block(a);
+        shared.free_block(b);
+        size_t largest = shared.largest_free_block();
+        assert(largest == 1000 || largest == 1010);
+        assert(largest > 1010 - 1010 / 16);
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_random_trace_consistency() {
+        std::cout << "Testing random trace consistency... ";
+        std::mt19937 rng(1234);
+        TlsfAllocator tlsf(1 << 18);
+
+        std::vector<std::pair<BlockHandle, size_t>> live;
+        size_t used = 0;
+
+        for (int op = 0; op < 20000; ++op) {
+            if (live.empty() || rng() % 3 != 0) {
+                size_t size = 1 + rng() % 4096;
+                BlockHandle id = tlsf.allocate(size);
+                if (id != -1) {
+                    live.push_back({id, size});
+                    used += size;
+                }
+            } else {
+                size_t victim = rng() % live.size();
+                tlsf.free_block(live[victim].first);
+                used -= live[victim].second;
+                live[victim] = live.back();
+                live.pop_back();
+            }
+            assert(tlsf.used_memory() == used);
+            assert(tlsf.live_allocations() == live.size());
+            if (op % 64 == 0) {
+                assert(tlsf.check_invariants());
+            }
+        }
+
+        // Live blocks must not overlap
+        std::vector<std::pair<size_t, size_t>> extents;
+        for (const auto& entry : live) {
+            extents.push_back({tlsf.block_start(entry.first), entry.second});
+        }
+        std::sort(extents.begin(), extents.end());
+        for (size_t i = 1; i < extents.size(); ++i) {
+            assert(extents[i - 1].first + extents[i - 1].second <= extents[i].first);
+        }
+
+        for (const auto& entry : live) {
+            tlsf.free_block(entry.first);
+        }
+        assert(tlsf.largest_free_block() == tlsf.total_memory());
+        assert(tlsf.check_invariants());
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_aligned_allocation() {
+        std::cout << "Testing aligned allocation... ";
+        TlsfAllocator tlsf(8192);
+
+        BlockHandle a = tlsf.allocate(100);
+        BlockHandle b = tlsf.allocate_aligned(200, 512);
+        assert(tlsf.block_start(b) % 512 == 0);
+        assert(tlsf.used_memory() == 300);
+
+        // The leading padding went back on the free lists
+        BlockHandle c = tlsf.allocate(64);
+        assert(tlsf.block_start(c) == 100);
+        assert(tlsf.check_invariants());
+
+        assert(tlsf.allocate_aligned(64, 3) == -1);
+        tlsf.free_block(a);
+        tlsf.free_block(b);
+        tlsf.free_block(c);
+
+        // The whole heap starts aligned to anything
+        BlockHandle all = tlsf.allocate_aligned(8192, 8192);
+        assert(tlsf.block_start(all) == 0);
+        tlsf.free_block(all);
+
+        std::mt19937 rng(23);
+        std::vector<std::pair<BlockHandle, size_t>> live;
+        for (int op = 0; op < 2000; ++op) {
+            if (live.empty() || rng() % 3 != 0) {
+                size_t alignment = static_cast<size_t>(1) << (rng() % 9);
+                BlockHandle id = tlsf.allocate_aligned(1 + rng() % 300, alignment);
+                if (id != -1) {
+                    assert(tlsf.block_start(id) % alignment == 0);
+                    live.push_back({id, alignment});
+                }
+            } else {
+                size_t victim = rng() % live.size();
+                tlsf.free_block(live[victim].first);
+                live[victim] = live.back();
+                live.pop_back();
+            }
+            if (op % 100 == 0) {
+                assert(tlsf.check_invariants());
+            }
+        }
+        assert(tlsf.check_invariants());
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_fresh_records_on_free_lists() {
+        std::cout << "Testing fresh records on free lists... ";
+        TlsfAllocator tlsf(4096);
+        assert(tlsf.check_invariants());
+
+        // Each split creates a record that goes straight onto an empty
+        // free list, so its link has to end the list
+        BlockHandle a = tlsf.allocate(100);
+        assert(tlsf.check_invariants());
+        BlockHandle b = tlsf.allocate_aligned(200, 256);
+        assert(tlsf.block_start(b) == 256);
+        assert(tlsf.check_invariants());
+        assert(tlsf.largest_free_block() == 4096 - 456);
+
+        // Both free pieces are found again through those links
+        BlockHandle pad = tlsf.allocate(144);
+        assert(tlsf.block_start(pad) == 100);
+        BlockHandle rest = tlsf.allocate(4096 - 456);
+        assert(tlsf.block_start(rest) == 456);
+        assert(tlsf.free_memory() == 12);
+        assert(tlsf.check_invariants());
+
+        tlsf.free_block(a);
+        tlsf.free_block(b);
+        tlsf.free_block(pad);
+        tlsf.free_block(rest);
+        assert(tlsf.largest_free_block() == 4096);
+        assert(tlsf.check_invariants());
+
+        std::cout << "PASSED\n";
+    }
+
+    static void test_reallocate() {
+        std::cout << "Testing reallocate... ";
+        TlsfAllocator tlsf(4096);
+
+        BlockHandle a = tlsf.allocate(100);
+        BlockHandle b = tlsf.allocate(100);
+
+        assert(tlsf.reallocate(a, 40));        // shrink: tail freed
+        assert(tlsf.used_memory() == 140);
+        assert(tlsf.reallocate(a, 100));       // grow back into it
+        assert(tlsf.reallocate(b, 1000));      // grow into the free tail
+        assert(tlsf.block_start(a) == 0 && tlsf.block_start(b) == 100);
+        assert(tlsf.realloc_stats().in_place == 3);
+        assert(tlsf.check_invariants());
+
+        assert(tlsf.reallocate(a, 300));       // b is in the way: move
+        assert(tlsf.block_start(a) >= 1100);
+        assert(tlsf.realloc_stats().moved == 1);
+        assert(tlsf.used_memory() == 1300);
+        assert(tlsf.check_invariants());
+
+        assert(!tlsf.reallocate(a, 8192));
+        assert(tlsf.realloc_stats().failed == 1);
+        assert(tlsf.block_start(a) >= 1100);
+
+        // A moved block keeps its alignment
+        TlsfAllocator aligned(8192);
+        aligned.allocate(24);
+        BlockHandle c = aligned.allocate_aligned(100, 256);
+        aligned.allocate(1000);  // too big for the padding, so it follows c
+        assert(aligned.block_start(c) == 256);
+        assert(aligned.reallocate(c, 500));
+        assert(aligned.block_start(c) != 256);
+        assert(aligned.block_start(c) % 256 == 0);
+        assert(aligned.check_invariants());
+
+        std::mt19937 rng(31);
+        std::vector<BlockHandle> live;
+        for (int op = 0; op < 3000; ++op) {
+            unsigned kind = rng() % 3;
+            if (live.empty() || kind == 0) {
+                BlockHandle id = tlsf.allocate(1 + rng() % 200);
+                if (id != -1) {
+                    live.push_back(id);
+                }
+            } else if (kind == 1) {
+                tlsf.reallocate(live[rng() % live.size()], 1 + rng() % 400);
+            } else {
+                size_t victim = rng() % live.size();
+                tlsf.free_block(live[victim]);
+                live[victim] = live.back();
+                live.pop_back();
+            }
+            if (op % 100 == 0) {
+                assert(tlsf.check_invariants());
+            }
+        }
+
+        std::cout << "PASSED\n";
+    }
+};
+
+int main() {
+    TlsfAllocatorTests::run_all_tests();
+    return 0;
+}